@@ -0,0 +1,209 @@
+// Замер чтения всех платежей: прежний путь через sqlite3_exec с разбором
+// текстовых значений в обратном вызове против RowMapper
+// (DatabaseManager::getPayments).
+//
+//   PaymentReadBench [файл базы] [число платежей]
+//
+// Если в базе меньше платежей, недостающие создаются один раз; повторные
+// запуски с тем же файлом только читают.
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <functional>
+#include <string>
+#include <vector>
+#include <sqlite3.h>
+#include "DatabaseManager.h"
+
+namespace {
+
+const int RUNS = 5;
+
+// Обратный вызов getPayments до RowMapper, без изменений
+int payment_select_callback(void *data, int argc, char **argv,
+                            char **azColName) {
+    auto *payments = static_cast<std::vector<Payment> *>(data);
+    Payment p;
+    for (int i = 0; i < argc; i++) {
+        std::string colName = azColName[i];
+        if (colName == "id")
+            p.id = argv[i] ? std::stoi(argv[i]) : -1;
+        else if (colName == "date")
+            p.date = argv[i] ? argv[i] : "";
+        else if (colName == "doc_number")
+            p.doc_number = argv[i] ? argv[i] : "";
+        else if (colName == "type")
+            p.type = argv[i] ? argv[i] : "";
+        else if (colName == "amount")
+            p.amount = argv[i] ? std::stod(argv[i]) : 0.0;
+        else if (colName == "recipient")
+            p.recipient = argv[i] ? argv[i] : "";
+        else if (colName == "description")
+            p.description = argv[i] ? argv[i] : "";
+        else if (colName == "counterparty_id")
+            p.counterparty_id = argv[i] ? std::stoi(argv[i]) : -1;
+    }
+    payments->push_back(p);
+    return 0;
+}
+
+std::vector<Payment> read_with_exec(sqlite3 *db) {
+    std::vector<Payment> payments;
+    char *errmsg = nullptr;
+    if (sqlite3_exec(db,
+                     "SELECT id, date, doc_number, type, amount, recipient, "
+                     "description, counterparty_id FROM Payments;",
+                     payment_select_callback, &payments,
+                     &errmsg) != SQLITE_OK) {
+        std::fprintf(stderr, "sqlite3_exec failed: %s\n", errmsg);
+        sqlite3_free(errmsg);
+    }
+    return payments;
+}
+
+long long count_payments(sqlite3 *db) {
+    sqlite3_stmt *stmt = nullptr;
+    long long count = 0;
+    if (sqlite3_prepare_v2(db, "SELECT COUNT(*) FROM Payments;", -1, &stmt,
+                           nullptr) == SQLITE_OK &&
+        sqlite3_step(stmt) == SQLITE_ROW) {
+        count = sqlite3_column_int64(stmt, 0);
+    }
+    sqlite3_finalize(stmt);
+    return count;
+}
+
+// Назначения в духе банковской выписки, чтобы строки были обычной длины
+bool generate_payments(sqlite3 *db, long long from, long long to) {
+    static const char *const TEMPLATES[] = {
+        "Оплата по контракту № %lld от 01.02.2021 за услуги связи; в т.ч. "
+        "К221=%lld.00",
+        "Оплата по дог. %lld-А от 05.03.2022 акт %lld от 06.03.2022 К226",
+        "Возврат средств по платёжному поручению %lld",
+        "Оплата по контр %lld от 10.10.2021, счет на оплату %lld от "
+        "11.10.2021 К225",
+    };
+    sqlite3_exec(db, "BEGIN;", nullptr, nullptr, nullptr);
+    sqlite3_stmt *stmt = nullptr;
+    if (sqlite3_prepare_v2(db,
+                           "INSERT INTO Payments (date, doc_number, type, "
+                           "amount, recipient, description) "
+                           "VALUES (?, ?, ?, ?, ?, ?);",
+                           -1, &stmt, nullptr) != SQLITE_OK) {
+        std::fprintf(stderr, "Cannot prepare insert: %s\n",
+                     sqlite3_errmsg(db));
+        sqlite3_exec(db, "ROLLBACK;", nullptr, nullptr, nullptr);
+        return false;
+    }
+    char date[16];
+    char doc_number[32];
+    char description[256];
+    for (long long i = from; i < to; ++i) {
+        std::snprintf(date, sizeof(date), "20%02lld-%02lld-%02lld",
+                      20 + i % 5, 1 + i % 12, 1 + i % 28);
+        std::snprintf(doc_number, sizeof(doc_number), "%lld", i + 1);
+        std::snprintf(description, sizeof(description), TEMPLATES[i % 4],
+                      i % 9973, i % 101);
+        sqlite3_bind_text(stmt, 1, date, -1, SQLITE_TRANSIENT);
+        sqlite3_bind_text(stmt, 2, doc_number, -1, SQLITE_TRANSIENT);
+        sqlite3_bind_text(stmt, 3, i % 4 == 2 ? "income" : "expense", -1,
+                          SQLITE_STATIC);
+        sqlite3_bind_double(stmt, 4, (i % 1000000) / 100.0 + 1.0);
+        sqlite3_bind_text(stmt, 5, "ООО \"Поставщик\"", -1, SQLITE_STATIC);
+        sqlite3_bind_text(stmt, 6, description, -1, SQLITE_TRANSIENT);
+        if (sqlite3_step(stmt) != SQLITE_DONE) {
+            std::fprintf(stderr, "Insert failed: %s\n", sqlite3_errmsg(db));
+            sqlite3_finalize(stmt);
+            sqlite3_exec(db, "ROLLBACK;", nullptr, nullptr, nullptr);
+            return false;
+        }
+        sqlite3_reset(stmt);
+    }
+    sqlite3_finalize(stmt);
+    return sqlite3_exec(db, "COMMIT;", nullptr, nullptr, nullptr) ==
+           SQLITE_OK;
+}
+
+// Сумма по всем полям: оба пути должны прочитать одно и то же
+unsigned long long checksum(const std::vector<Payment> &payments) {
+    unsigned long long sum = 0;
+    std::hash<std::string> hash;
+    for (const auto &p : payments) {
+        sum = sum * 31 + static_cast<unsigned long long>(p.id);
+        sum += hash(p.date) ^ hash(p.doc_number) ^ hash(p.type) ^
+               hash(p.recipient) ^ hash(p.description);
+        sum += static_cast<unsigned long long>(p.amount * 100.0 + 0.5);
+        sum += static_cast<unsigned long long>(p.counterparty_id);
+    }
+    return sum;
+}
+
+double best_of(const std::function<std::vector<Payment>()> &read,
+               size_t &rows, unsigned long long &sum) {
+    double best = 0.0;
+    for (int run = 0; run < RUNS; ++run) {
+        const auto start = std::chrono::steady_clock::now();
+        std::vector<Payment> payments = read();
+        const double ms = std::chrono::duration<double, std::milli>(
+                              std::chrono::steady_clock::now() - start)
+                              .count();
+        best = run == 0 ? ms : std::min(best, ms);
+        rows = payments.size();
+        sum = checksum(payments);
+    }
+    return best;
+}
+
+} // namespace
+
+int main(int argc, char **argv) {
+    const std::string path = argc > 1 ? argv[1] : "payment_bench.db";
+    const long long wanted = argc > 2 ? std::atoll(argv[2]) : 1000000;
+
+    // Схема создаётся миграциями, как у обычной базы
+    DatabaseManager manager;
+    if (!manager.open(path)) {
+        std::fprintf(stderr, "Cannot open %s\n", path.c_str());
+        return 1;
+    }
+    sqlite3 *db = nullptr;
+    if (sqlite3_open(path.c_str(), &db) != SQLITE_OK) {
+        std::fprintf(stderr, "Cannot open %s: %s\n", path.c_str(),
+                     sqlite3_errmsg(db));
+        sqlite3_close(db);
+        return 1;
+    }
+    sqlite3_busy_timeout(db, 5000);
+
+    const long long existing = count_payments(db);
+    if (existing < wanted) {
+        std::printf("Generating %lld payments...\n", wanted - existing);
+        if (!generate_payments(db, existing, wanted)) {
+            sqlite3_close(db);
+            return 1;
+        }
+    }
+
+    size_t exec_rows = 0;
+    size_t mapper_rows = 0;
+    unsigned long long exec_sum = 0;
+    unsigned long long mapper_sum = 0;
+    const double exec_ms = best_of([db]() { return read_with_exec(db); },
+                                   exec_rows, exec_sum);
+    const double mapper_ms =
+        best_of([&manager]() { return manager.getPayments(); }, mapper_rows,
+                mapper_sum);
+    sqlite3_close(db);
+
+    std::printf("Payments read:            %zu\n", mapper_rows);
+    std::printf("sqlite3_exec + callback:  %.0f ms (best of %d)\n", exec_ms,
+                RUNS);
+    std::printf("RowMapper (getPayments):  %.0f ms (best of %d)\n", mapper_ms,
+                RUNS);
+    if (exec_rows != mapper_rows || exec_sum != mapper_sum) {
+        std::fprintf(stderr, "Results differ between the two paths\n");
+        return 1;
+    }
+    return 0;
+}
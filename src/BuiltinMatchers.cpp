@@ -0,0 +1,223 @@
+#include "BuiltinMatchers.h"
+#include <string_view>
+#include <vector>
+
+namespace BuiltinMatchers {
+
+const char *const CONTRACT_PATTERN =
+    "(?:по контракту|по контр|Контракт|дог\\.|К-т)(?: №)?\\s*([^\\s,]+)\\s*"
+    "(?:от\\s*)?(\\d{2}\\.\\d{2}\\.(?:\\d{2}|\\d{4}))";
+const char *const INVOICE_PATTERN =
+    "(?:акт|сч\\.?|сч-ф|счет на оплату|№)\\s*([^\\s,]+)\\s*"
+    "(?:от\\s*)?(\\d{2}\\.\\d{2}\\.(?:\\d{2}|\\d{4}))";
+const char *const KOSGU_PATTERN = "К(\\d{3})";
+const char *const KOSGU_DETAILS_PATTERN = "К(\\d{3})=([\\d.]+)";
+
+} // namespace BuiltinMatchers
+
+namespace {
+
+// \s в std::regex для char: пробел, \t, \n, \v, \f, \r
+bool is_space(char c) {
+    return c == ' ' || (c >= '\t' && c <= '\r');
+}
+
+bool is_digit(char c) { return c >= '0' && c <= '9'; }
+
+size_t skip_spaces(std::string_view text, size_t pos) {
+    while (pos < text.size() && is_space(text[pos])) {
+        pos++;
+    }
+    return pos;
+}
+
+bool starts_with(std::string_view text, size_t pos, std::string_view prefix) {
+    return text.size() - pos >= prefix.size() &&
+           text.compare(pos, prefix.size(), prefix) == 0;
+}
+
+// \d{2}\.\d{2}\.(?:\d{2}|\d{4}): первая альтернатива года всегда
+// срабатывает раньше второй, и после даты в шаблоне ничего нет, поэтому
+// совпадение всегда занимает ровно 8 байт (год из двух цифр).
+const size_t DATE_LENGTH = 8;
+
+bool date_at(std::string_view text, size_t pos) {
+    return text.size() - pos >= DATE_LENGTH && is_digit(text[pos]) &&
+           is_digit(text[pos + 1]) && text[pos + 2] == '.' &&
+           is_digit(text[pos + 3]) && is_digit(text[pos + 4]) &&
+           text[pos + 5] == '.' && is_digit(text[pos + 6]) &&
+           is_digit(text[pos + 7]);
+}
+
+// Хвост "\s*([^\s,]+)\s*(?:от\s*)?(дата)" начиная с pos. Откат \s* перед
+// группами ничего не даёт (группа и дата не начинаются с пробела), так что
+// перебирается только длина номера - от самой длинной, как у жадного +.
+bool match_number_and_date(std::string_view text, size_t pos,
+                           std::string_view &number, size_t &date_pos) {
+    static const std::string_view from = "от";
+    const size_t number_begin = skip_spaces(text, pos);
+    size_t number_max = number_begin;
+    while (number_max < text.size() && !is_space(text[number_max]) &&
+           text[number_max] != ',') {
+        number_max++;
+    }
+    for (size_t number_end = number_max; number_end > number_begin;
+         --number_end) {
+        const size_t after_number = skip_spaces(text, number_end);
+        if (starts_with(text, after_number, from)) {
+            const size_t candidate =
+                skip_spaces(text, after_number + from.size());
+            if (date_at(text, candidate)) {
+                number = text.substr(number_begin, number_end - number_begin);
+                date_pos = candidate;
+                return true;
+            }
+        }
+        if (date_at(text, after_number)) {
+            number = text.substr(number_begin, number_end - number_begin);
+            date_pos = after_number;
+            return true;
+        }
+    }
+    return false;
+}
+
+// (?:ключевое|слово|...)(?: №)?<номер и дата> для Contract и Invoice.
+class KeywordNumberDateMatcher : public RegexMatcher {
+public:
+    KeywordNumberDateMatcher(std::vector<std::string_view> keywords,
+                             bool optional_number_sign)
+        : keywords(std::move(keywords)),
+          optionalNumberSign(optional_number_sign) {
+        for (auto keyword : this->keywords) {
+            firstBytes[static_cast<unsigned char>(keyword[0])] = true;
+        }
+    }
+
+    bool Search(std::string_view text, std::vector<std::string_view> &groups,
+                size_t pos) const override {
+        static const std::string_view number_sign = " №";
+        groups.clear();
+        for (size_t start = pos; start < text.size(); ++start) {
+            if (!firstBytes[static_cast<unsigned char>(text[start])]) {
+                continue;
+            }
+            for (auto keyword : keywords) {
+                if (!starts_with(text, start, keyword)) {
+                    continue;
+                }
+                const size_t after_keyword = start + keyword.size();
+                std::string_view number;
+                size_t date_pos = 0;
+                bool found = false;
+                if (optionalNumberSign &&
+                    starts_with(text, after_keyword, number_sign)) {
+                    found = match_number_and_date(
+                        text, after_keyword + number_sign.size(), number,
+                        date_pos);
+                }
+                if (!found) {
+                    found = match_number_and_date(text, after_keyword, number,
+                                                  date_pos);
+                }
+                if (found) {
+                    groups.push_back(text.substr(
+                        start, date_pos + DATE_LENGTH - start));
+                    groups.push_back(number);
+                    groups.push_back(text.substr(date_pos, DATE_LENGTH));
+                    return true;
+                }
+            }
+        }
+        return false;
+    }
+
+    int GroupCount() const override { return 2; }
+    const char *Backend() const override { return "builtin"; }
+
+private:
+    std::vector<std::string_view> keywords; // В порядке альтернатив шаблона
+    bool optionalNumberSign;
+    bool firstBytes[256] = {};
+};
+
+// К(\d{3}) и К(\d{3})=([\d.]+)
+class KosguCodeMatcher : public RegexMatcher {
+public:
+    explicit KosguCodeMatcher(bool with_amount) : withAmount(with_amount) {}
+
+    bool Search(std::string_view text, std::vector<std::string_view> &groups,
+                size_t pos) const override {
+        static const std::string_view letter = "К";
+        groups.clear();
+        while (pos < text.size()) {
+            const size_t start = text.find(letter, pos);
+            if (start == std::string_view::npos) {
+                return false;
+            }
+            pos = start + 1;
+            const size_t code = start + letter.size();
+            if (text.size() - code < 3 || !is_digit(text[code]) ||
+                !is_digit(text[code + 1]) || !is_digit(text[code + 2])) {
+                continue;
+            }
+            if (!withAmount) {
+                groups.push_back(text.substr(start, code + 3 - start));
+                groups.push_back(text.substr(code, 3));
+                return true;
+            }
+            const size_t amount = code + 4;
+            if (amount > text.size() || text[code + 3] != '=') {
+                continue;
+            }
+            size_t amount_end = amount;
+            while (amount_end < text.size() &&
+                   (is_digit(text[amount_end]) || text[amount_end] == '.')) {
+                amount_end++;
+            }
+            if (amount_end == amount) {
+                continue;
+            }
+            groups.push_back(text.substr(start, amount_end - start));
+            groups.push_back(text.substr(code, 3));
+            groups.push_back(text.substr(amount, amount_end - amount));
+            return true;
+        }
+        return false;
+    }
+
+    int GroupCount() const override { return withAmount ? 2 : 1; }
+    const char *Backend() const override { return "builtin"; }
+
+private:
+    bool withAmount;
+};
+
+} // namespace
+
+namespace BuiltinMatchers {
+
+std::shared_ptr<const RegexMatcher> Find(const std::string &pattern) {
+    if (pattern == CONTRACT_PATTERN) {
+        return std::make_shared<KeywordNumberDateMatcher>(
+            std::vector<std::string_view>{"по контракту", "по контр",
+                                          "Контракт", "дог.", "К-т"},
+            true);
+    }
+    if (pattern == INVOICE_PATTERN) {
+        // сч\.? жадный: сначала "сч." и только потом "сч"
+        return std::make_shared<KeywordNumberDateMatcher>(
+            std::vector<std::string_view>{"акт", "сч.", "сч", "сч-ф",
+                                          "счет на оплату", "№"},
+            false);
+    }
+    if (pattern == KOSGU_PATTERN) {
+        return std::make_shared<KosguCodeMatcher>(false);
+    }
+    if (pattern == KOSGU_DETAILS_PATTERN) {
+        return std::make_shared<KosguCodeMatcher>(true);
+    }
+    return nullptr;
+}
+
+} // namespace BuiltinMatchers
@@ -0,0 +1,27 @@
+#pragma once
+
+#include "RegexMatcher.h"
+#include <memory>
+#include <string>
+
+// Написанные вручную сканеры для шаблонов, которые создаются в базе по
+// умолчанию (Contract, Invoice, KOSGU), и для расшифровки "; в т.ч.".
+// Вместо общего движка они ищут ключевые слова напрямую и разбирают номер
+// и дату без промежуточных состояний, повторяя порядок перебора
+// регулярного выражения (ключевые слова по порядку, жадные группы с
+// откатом), поэтому результат совпадает с ним байт в байт. Совпадение
+// проверяет tests/BuiltinMatchersTest.cpp.
+namespace BuiltinMatchers {
+
+// Шаблоны Contract, Invoice и KOSGU из таблицы Regexes по умолчанию
+extern const char *const CONTRACT_PATTERN;
+extern const char *const INVOICE_PATTERN;
+extern const char *const KOSGU_PATTERN;
+// Шаблон расшифровки по КОСГУ после "; в т.ч." в назначении платежа
+extern const char *const KOSGU_DETAILS_PATTERN;
+
+// Returns a scanner equivalent to 'pattern' if it is exactly one of the
+// built-in patterns, nullptr otherwise.
+std::shared_ptr<const RegexMatcher> Find(const std::string &pattern);
+
+} // namespace BuiltinMatchers
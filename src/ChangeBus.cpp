@@ -0,0 +1,63 @@
+#include "ChangeBus.h"
+#include <algorithm>
+
+void DbChangeSet::Add(DbTable table, DbChangeKind kind, long long id) {
+    if (kind == DbChangeKind::Reload) {
+        AddReload(table);
+        return;
+    }
+    const size_t index = static_cast<size_t>(table);
+    if (reload[index]) {
+        return;
+    }
+    if (++rowCounts[index] > ROW_LIMIT) {
+        AddReload(table);
+        return;
+    }
+    changes.push_back({table, kind, id});
+    tables |= 1u << index;
+}
+
+void DbChangeSet::AddReload(DbTable table) {
+    const size_t index = static_cast<size_t>(table);
+    if (reload[index]) {
+        return;
+    }
+    // Перечитывание перекрывает более ранние изменения строк таблицы, а
+    // более поздние отбрасываются в Add
+    changes.erase(std::remove_if(changes.begin(), changes.end(),
+                                 [table](const DbChange &change) {
+                                     return change.table == table;
+                                 }),
+                  changes.end());
+    changes.push_back({table, DbChangeKind::Reload, 0});
+    reload[index] = true;
+    tables |= 1u << index;
+}
+
+void DbChangeSet::Append(const DbChangeSet &other) {
+    for (const auto &change : other.changes) {
+        Add(change.table, change.kind, change.id);
+    }
+}
+
+void DbChangeSet::Clear() {
+    changes.clear();
+    rowCounts.fill(0);
+    reload.fill(false);
+    tables = 0;
+}
+
+void ChangeBus::Publish(const DbChangeSet &changes) {
+    if (changes.Empty()) {
+        return;
+    }
+    std::lock_guard<std::mutex> lock(mutex);
+    queued.Append(changes);
+}
+
+void ChangeBus::Take(DbChangeSet &changes) {
+    changes.Clear();
+    std::lock_guard<std::mutex> lock(mutex);
+    std::swap(changes, queued);
+}
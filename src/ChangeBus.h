@@ -0,0 +1,76 @@
+#pragma once
+
+#include <array>
+#include <mutex>
+#include <vector>
+
+// Tables whose committed changes are counted (see
+// DatabaseManager::getTableVersion) and published on the ChangeBus
+enum class DbTable {
+    Kosgu,
+    Counterparties,
+    Contracts,
+    Invoices,
+    Payments,
+    PaymentDetails,
+    Settings,
+    Count
+};
+
+enum class DbChangeKind {
+    Insert,
+    Update,
+    Delete,
+    // Таблица изменилась целиком или слишком сильно, чтобы перечислять
+    // строки (импорт, смена базы): кэш нужно перечитать
+    Reload
+};
+
+// Изменение одной строки таблицы; id - rowid, он же первичный ключ id
+struct DbChange {
+    DbTable table;
+    DbChangeKind kind;
+    long long id;
+};
+
+// Изменения в порядке появления. Когда в таблице накапливается больше
+// ROW_LIMIT изменённых строк, они заменяются одним Reload: после импорта
+// дешевле перечитать таблицу, чем применять тысячи правок по одной.
+class DbChangeSet {
+public:
+    static const size_t ROW_LIMIT = 256;
+
+    void Add(DbTable table, DbChangeKind kind, long long id);
+    void AddReload(DbTable table);
+    void Append(const DbChangeSet& other);
+    void Clear();
+
+    bool Empty() const { return changes.empty(); }
+    const std::vector<DbChange>& Changes() const { return changes; }
+    // Bit (1 << DbTable) for every table with changes.
+    unsigned Tables() const { return tables; }
+
+private:
+    static const size_t TABLE_COUNT = static_cast<size_t>(DbTable::Count);
+
+    std::vector<DbChange> changes;
+    std::array<size_t, TABLE_COUNT> rowCounts{};
+    std::array<bool, TABLE_COUNT> reload{};
+    unsigned tables = 0;
+};
+
+// Очередь зафиксированных изменений от всех соединений с базой (окна и
+// импорт) к потоку интерфейса. Соединения публикуют изменения после
+// фиксации транзакции, интерфейс забирает их один раз за кадр и раздаёт
+// окнам, которые правят свои списки вместо полного перечитывания.
+class ChangeBus {
+public:
+    // Thread-safe; called after the transaction with 'changes' committed.
+    void Publish(const DbChangeSet& changes);
+    // Moves everything published since the previous call into 'changes'.
+    void Take(DbChangeSet& changes);
+
+private:
+    std::mutex mutex;
+    DbChangeSet queued;
+};
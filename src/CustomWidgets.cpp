@@ -1,7 +1,10 @@
 
 #include "CustomWidgets.h"
 #include "imgui.h"
+#include "imgui_stdlib.h"
+#include <cmath>
 #include <string>
+#include <vector>
 
 namespace CustomWidgets {
 
@@ -26,6 +29,18 @@ static int InputTextCallback(ImGuiInputTextCallbackData *data) {
     }
     return 0;
 }
+
+// Открытым бывает только один выпадающий список, поэтому состояние поиска
+// общее и сбрасывается при открытии
+struct ComboSearchState {
+    ImGuiID owner = 0;
+    std::string filter;
+    const LabelIndex *items = nullptr;
+    unsigned generation = 0;
+    std::vector<int> matches;
+};
+
+ComboSearchState combo_search;
 } // namespace
 
 bool InputTextMultiline(const char *label, std::string *str, const ImVec2 &size,
@@ -43,4 +58,114 @@ bool InputTextMultiline(const char *label, std::string *str, const ImVec2 &size,
                                      InputTextCallback, &cb_user_data);
 }
 
+bool SearchableCombo(const char *label, const char *preview,
+                     const LabelIndex &items, int &position) {
+    if (!ImGui::BeginCombo(label, preview, ImGuiComboFlags_HeightLarge)) {
+        return false;
+    }
+
+    ComboSearchState &state = combo_search;
+    const bool appearing = ImGui::IsWindowAppearing();
+    const ImGuiID id = ImGui::GetID(label);
+    bool search = false;
+    if (appearing || state.owner != id) {
+        state.owner = id;
+        state.filter.clear();
+        search = true;
+    }
+    // Справочник могли перечитать, пока список открыт
+    if (state.items != &items || state.generation != items.Generation()) {
+        search = true;
+    }
+
+    if (appearing) {
+        ImGui::SetKeyboardFocusHere();
+    }
+    ImGui::SetNextItemWidth(-FLT_MIN);
+    const bool enter = ImGui::InputTextWithHint(
+        "##search", "Поиск...", &state.filter,
+        ImGuiInputTextFlags_EnterReturnsTrue);
+    if (ImGui::IsItemEdited()) {
+        search = true;
+    }
+    if (search) {
+        state.items = &items;
+        state.generation = items.Generation();
+        items.Find(state.filter, state.matches);
+    }
+
+    bool changed = false;
+    const int count = static_cast<int>(state.matches.size());
+    if (enter && count > 0) {
+        changed = state.matches[0] != position;
+        position = state.matches[0];
+        ImGui::CloseCurrentPopup();
+    }
+
+    if (count == 0) {
+        ImGui::TextDisabled("Ничего не найдено");
+        ImGui::EndCombo();
+        return changed;
+    }
+
+    // Список прокручивается отдельно, поле поиска остаётся на месте
+    const float row_height = ImGui::GetTextLineHeightWithSpacing();
+    const int visible_rows = count < 20 ? count : 20;
+    ImGui::BeginChild("##items", ImVec2(0, visible_rows * row_height));
+    ImGuiListClipper clipper;
+    clipper.Begin(count, row_height);
+    // При открытии фильтр пуст, так что строка списка совпадает с позицией;
+    // выбранный элемент рисуется и прокручивается в видимую область, даже
+    // если он далеко от начала
+    const bool reveal = appearing && position >= 0 && position < count;
+    if (reveal) {
+        clipper.IncludeItemByIndex(position);
+    }
+    while (clipper.Step()) {
+        for (int row = clipper.DisplayStart; row < clipper.DisplayEnd; ++row) {
+            const int item = state.matches[row];
+            const bool selected = item == position;
+            ImGui::PushID(item);
+            if (ImGui::Selectable(items.Label(item).c_str(), selected)) {
+                changed = item != position;
+                position = item;
+            }
+            ImGui::PopID();
+            if (selected && reveal) {
+                ImGui::SetScrollHereY();
+            }
+        }
+    }
+    clipper.End();
+    ImGui::EndChild();
+
+    ImGui::EndCombo();
+    return changed;
+}
+
+void Spinner(const char *label) {
+    const float size = ImGui::GetTextLineHeight();
+    const float radius = size * 0.4f;
+    const ImVec2 origin = ImGui::GetCursorScreenPos();
+    const ImVec2 center(origin.x + size * 0.5f, origin.y + size * 0.5f);
+    ImGui::Dummy(ImVec2(size, size));
+
+    // Дуга в три четверти окружности, поворачивается со временем
+    const int segments = 24;
+    const float start = static_cast<float>(ImGui::GetTime()) * 6.0f;
+    const float length = 3.0f * 3.14159265f / 2.0f;
+    ImDrawList *draw_list = ImGui::GetWindowDrawList();
+    draw_list->PathClear();
+    for (int i = 0; i <= segments; ++i) {
+        const float angle = start + length * i / segments;
+        draw_list->PathLineTo(ImVec2(center.x + std::cos(angle) * radius,
+                                     center.y + std::sin(angle) * radius));
+    }
+    draw_list->PathStroke(ImGui::GetColorU32(ImGuiCol_Text), 0,
+                          size * 0.12f);
+
+    ImGui::SameLine();
+    ImGui::TextUnformatted(label);
+}
+
 } // namespace CustomWidgets
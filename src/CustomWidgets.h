@@ -1,4 +1,5 @@
 #pragma once
+#include "LabelIndex.h"
 #include "imgui.h"
 #include <string>
 
@@ -6,4 +7,14 @@ namespace CustomWidgets {
 bool InputTextMultiline(const char *label, std::string *str,
                         const ImVec2 &size = ImVec2(0, 0),
                         ImGuiInputTextFlags flags = 0);
+
+// Combo box over a large list with a search field at the top of the popup.
+// Only visible rows are drawn. 'position' is the selected position in
+// 'items' (-1 for none); returns true when the user picks another item.
+// Enter in the search field picks the first match.
+bool SearchableCombo(const char *label, const char *preview,
+                     const LabelIndex &items, int &position);
+
+// Rotating arc the height of a text line, followed by 'label'.
+void Spinner(const char *label);
 }
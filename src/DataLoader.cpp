@@ -0,0 +1,154 @@
+#include "DataLoader.h"
+#include <iostream>
+
+DataLoader::DataLoader() : worker([this]() { WorkerLoop(); }) {}
+
+DataLoader::~DataLoader() {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+    }
+    wake.notify_one();
+    worker.join();
+}
+
+void DataLoader::SetDatabaseManager(DatabaseManager *manager) {
+    dbManager = manager;
+}
+
+void DataLoader::Enqueue(const void *owner,
+                         std::function<void(DatabaseManager &)> read,
+                         std::function<void()> apply) {
+    if (!dbManager || !dbManager->is_open()) {
+        return;
+    }
+    Task task{owner, nextTicket++, dbManager->getDatabasePath(),
+              dbManager->getTableVersion(DbTable::Settings), std::move(read),
+              std::move(apply)};
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        databasePath = task.path;
+        latestTickets[owner] = task.ticket;
+        queued.push_back(std::move(task));
+    }
+    wake.notify_one();
+}
+
+bool DataLoader::IsCurrent(const Task &task) const {
+    auto it = latestTickets.find(task.owner);
+    return it != latestTickets.end() && it->second == task.ticket;
+}
+
+bool DataLoader::IsLoading(const void *owner) const {
+    std::lock_guard<std::mutex> lock(mutex);
+    return latestTickets.count(owner) != 0;
+}
+
+void DataLoader::SetDatabasePath(const std::string &path) {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (databasePath == path) {
+            return;
+        }
+        databasePath = path;
+    }
+    wake.notify_one();
+}
+
+void DataLoader::Deliver() {
+    SetDatabasePath(dbManager ? dbManager->getDatabasePath() : "");
+
+    std::vector<Task> done;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (finished.empty()) {
+            return;
+        }
+        done.swap(finished);
+        for (auto &task : done) {
+            if (IsCurrent(task)) {
+                latestTickets.erase(task.owner);
+            } else {
+                task.apply = nullptr; // Пока читали, запросили новую
+            }
+        }
+    }
+    // Билеты сняты до вызова apply: из него можно начать новую загрузку
+    const std::string path = dbManager ? dbManager->getDatabasePath() : "";
+    for (auto &task : done) {
+        if (task.apply && task.path == path) {
+            task.apply();
+        }
+    }
+}
+
+void DataLoader::WorkerLoop() {
+    // Соединение принадлежит потоку загрузки и переоткрывается при смене
+    // файла базы
+    std::unique_ptr<DatabaseManager> connection;
+    std::string connectionPath;
+    unsigned long long connectionSettingsVersion = 0;
+
+    std::unique_lock<std::mutex> lock(mutex);
+    for (;;) {
+        wake.wait(lock, [&]() {
+            return stopping || !queued.empty() ||
+                   (connection && connectionPath != databasePath);
+        });
+        if (stopping) {
+            break;
+        }
+        if (connection && connectionPath != databasePath) {
+            // Окна открыли другую базу или закрыли эту: файл не должен
+            // оставаться открытым до следующей загрузки
+            lock.unlock();
+            connection.reset();
+            lock.lock();
+            continue;
+        }
+        Task task = std::move(queued.front());
+        queued.pop_front();
+        if (!IsCurrent(task)) {
+            continue; // Заменена более новой загрузкой того же владельца
+        }
+        if (task.path != databasePath) {
+            // Загрузка из прежнего файла: её результат всё равно не
+            // применится, а файл не нужно открывать снова
+            task.read = nullptr;
+            finished.push_back(std::move(task));
+            continue;
+        }
+        lock.unlock();
+
+        if (!connection || connectionPath != task.path) {
+            connection = std::make_unique<DatabaseManager>();
+            connectionPath = task.path;
+            if (!connection->openSecondary(task.path)) {
+                std::cerr << "Cannot open loader connection to " << task.path
+                          << std::endl;
+                connection.reset();
+            }
+            connectionSettingsVersion = task.settingsVersion;
+        } else if (connection &&
+                   connectionSettingsVersion != task.settingsVersion) {
+            // Настройки соединения сохранили после открытия
+            connection->applyConnectionSettings(connection->getSettings());
+            connectionSettingsVersion = task.settingsVersion;
+        }
+        // Без соединения окно получает пустой результат, а не вечную
+        // загрузку
+        try {
+            if (connection) {
+                task.read(*connection);
+            }
+        } catch (const std::exception &e) {
+            std::cerr << "Background load failed: " << e.what() << std::endl;
+        }
+        task.read = nullptr;
+
+        lock.lock();
+        finished.push_back(std::move(task));
+    }
+    lock.unlock();
+    connection.reset();
+}
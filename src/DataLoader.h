@@ -0,0 +1,85 @@
+#pragma once
+
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+#include "DatabaseManager.h"
+
+// Загрузка данных окон в фоновом потоке через собственное соединение с
+// базой, чтобы первое открытие окна на большой базе не останавливало
+// интерфейс. Результаты применяются в потоке интерфейса в начале кадра
+// (Deliver), так что окно видит либо старые данные, либо новые целиком.
+// Загрузки различаются владельцем (обычно окном): новая загрузка того же
+// владельца отменяет ещё не выполненную и результат уже выполненной.
+// Соединение потока закрывается, когда окна переключаются на другой файл
+// или закрывают базу: Deliver замечает это на следующем кадре.
+class DataLoader {
+public:
+    DataLoader();
+    // Stops the worker thread; loads that did not finish are dropped.
+    ~DataLoader();
+    DataLoader(const DataLoader&) = delete;
+    DataLoader& operator=(const DataLoader&) = delete;
+
+    // Database whose file is read; results of loads from another file are
+    // dropped.
+    void SetDatabaseManager(DatabaseManager* manager);
+
+    // Runs 'read' on the worker thread with the loader's connection, then
+    // 'apply' with the result on the UI thread in Deliver().
+    template <typename Result>
+    void Load(const void* owner, std::function<Result(DatabaseManager&)> read,
+              std::function<void(Result&)> apply) {
+        auto result = std::make_shared<Result>();
+        Enqueue(owner,
+                [read = std::move(read), result](DatabaseManager& db) {
+                    *result = read(db);
+                },
+                [apply = std::move(apply), result]() { apply(*result); });
+    }
+
+    // True from Load() until its result is applied or dropped.
+    bool IsLoading(const void* owner) const;
+    // UI thread, once per frame: applies the results of finished loads and
+    // tells the worker which file the windows now use.
+    void Deliver();
+
+private:
+    struct Task {
+        const void* owner;
+        unsigned long long ticket;
+        std::string path;
+        // Версия Settings в соединении окон на момент Load
+        unsigned long long settingsVersion;
+        std::function<void(DatabaseManager&)> read;
+        std::function<void()> apply;
+    };
+
+    void Enqueue(const void* owner, std::function<void(DatabaseManager&)> read,
+                 std::function<void()> apply);
+    bool IsCurrent(const Task& task) const; // Вызывается под mutex
+    void SetDatabasePath(const std::string& path);
+    void WorkerLoop();
+
+    DatabaseManager* dbManager = nullptr;
+    unsigned long long nextTicket = 1;
+
+    mutable std::mutex mutex;
+    std::condition_variable wake;
+    bool stopping = false;
+    // Файл соединения окон; загрузки из другого файла не выполняются, а
+    // соединение потока с ним закрывается
+    std::string databasePath;
+    std::deque<Task> queued;
+    std::vector<Task> finished;
+    // Билет последней загрузки каждого владельца; удаляется при выдаче
+    std::unordered_map<const void*, unsigned long long> latestTickets;
+
+    std::thread worker; // Последним: запускается, когда остальное готово
+};
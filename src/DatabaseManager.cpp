@@ -1,13 +1,102 @@
 #include "DatabaseManager.h"
+#include "PaymentFingerprint.h"
+#include "RowMapper.h"
+#include "Utf8.h"
+#include <algorithm>
+#include <cstring>
 #include <iostream>
 #include <vector>
 
+// Идентификатор -1 означает "не выбрано" и хранится в базе как NULL
+static void bind_optional_id(sqlite3_stmt *stmt, int index, int id) {
+    if (id != -1) {
+        sqlite3_bind_int(stmt, index, id);
+    } else {
+        sqlite3_bind_null(stmt, index);
+    }
+}
+
+// Порядок полей совпадает с порядком столбцов в SELECT загрузчиков
+static const auto kosgu_columns =
+    RowMapper::Columns(&Kosgu::id, &Kosgu::code, &Kosgu::name);
+static const auto counterparty_columns = RowMapper::Columns(
+    &Counterparty::id, &Counterparty::name, &Counterparty::inn);
+static const auto contract_columns =
+    RowMapper::Columns(&Contract::id, &Contract::number, &Contract::date,
+                       &Contract::counterparty_id);
+static const auto invoice_columns =
+    RowMapper::Columns(&Invoice::id, &Invoice::number, &Invoice::date,
+                       &Invoice::contract_id);
+static const auto payment_columns = RowMapper::Columns(
+    &Payment::id, &Payment::date, &Payment::doc_number, &Payment::type,
+    &Payment::amount, &Payment::recipient, &Payment::description,
+    &Payment::counterparty_id);
+static const auto payment_detail_columns = RowMapper::Columns(
+    &PaymentDetail::id, &PaymentDetail::payment_id, &PaymentDetail::kosgu_id,
+    &PaymentDetail::contract_id, &PaymentDetail::invoice_id,
+    &PaymentDetail::amount);
+static const auto regex_columns =
+    RowMapper::Columns(&Regex::id, &Regex::name, &Regex::pattern);
+static const auto checkpoint_columns = RowMapper::Columns(
+    &ImportCheckpoint::file_path, &ImportCheckpoint::file_size,
+    &ImportCheckpoint::file_hash, &ImportCheckpoint::byte_offset,
+    &ImportCheckpoint::rows_committed, &ImportCheckpoint::updated_at);
+static const auto payment_info_columns = RowMapper::Columns(
+    &ContractPaymentInfo::date, &ContractPaymentInfo::doc_number,
+    &ContractPaymentInfo::amount, &ContractPaymentInfo::description);
+
+// SQL-функция casefold(text): нижний регистр с учётом кириллицы.
+// Зарегистрирована с одним аргументом, поэтому argc не проверяется.
+static void casefold_sql_function(sqlite3_context *context, int,
+                                  sqlite3_value **argv) {
+    const unsigned char *text = sqlite3_value_text(argv[0]);
+    if (!text) {
+        sqlite3_result_null(context);
+        return;
+    }
+    std::string folded = Utf8::FoldCase(reinterpret_cast<const char *>(text));
+    sqlite3_result_text(context, folded.c_str(), (int)folded.size(),
+                        SQLITE_TRANSIENT);
+}
+
+// Порог страниц WAL для контрольной точки, как у
+// sqlite3_wal_autocheckpoint, который заменяет собственный хук WAL
+static const int WAL_AUTOCHECKPOINT_PAGES = 1000;
+
+// Таблица из хука обновления; -1 для неотслеживаемых
+static int tracked_table(const char *table) {
+    static const char *const names[] = {"KOSGU",    "Counterparties",
+                                        "Contracts", "Invoices",
+                                        "Payments", "PaymentDetails",
+                                        "Settings"};
+    for (size_t i = 0; i < sizeof(names) / sizeof(names[0]); ++i) {
+        if (strcmp(table, names[i]) == 0) {
+            return static_cast<int>(i);
+        }
+    }
+    return -1;
+}
+
 DatabaseManager::DatabaseManager()
-    : db(nullptr) {}
+    : db(nullptr), tableVersions(std::make_shared<TableVersions>()),
+      changeBus(std::make_shared<ChangeBus>()) {
+    for (auto &version : *tableVersions) {
+        version = 0;
+    }
+}
 
 DatabaseManager::~DatabaseManager() { close(); }
 
 bool DatabaseManager::open(const std::string &filepath) {
+    return openConnection(filepath, true);
+}
+
+bool DatabaseManager::openSecondary(const std::string &filepath) {
+    return openConnection(filepath, false);
+}
+
+bool DatabaseManager::openConnection(const std::string &filepath,
+                                     bool run_migrations) {
     if (db) {
         close();
     }
@@ -15,19 +104,180 @@ bool DatabaseManager::open(const std::string &filepath) {
     if (rc != SQLITE_OK) {
         std::cerr << "Cannot open database: " << sqlite3_errmsg(db)
                   << std::endl;
+        close();
+        return false;
+    }
+
+    // WAL позволяет читать базу, пока другое соединение пишет; при WAL
+    // synchronous=NORMAL безопасен и не делает fsync на каждую транзакцию.
+    sqlite3_busy_timeout(db, 5000);
+    execute("PRAGMA journal_mode = WAL;");
+    execute("PRAGMA synchronous = NORMAL;");
+    execute("PRAGMA foreign_keys = ON;");
+    sqlite3_create_function_v2(db, "casefold", 1,
+                               SQLITE_UTF8 | SQLITE_DETERMINISTIC, nullptr,
+                               casefold_sql_function, nullptr, nullptr,
+                               nullptr);
+
+    if (run_migrations && !migrate()) {
+        close();
         return false;
     }
 
+    applyConnectionSettings(getSettings());
+    fullTextSearch = tableExists("PaymentsFts");
+    trigramIndex = tableExists("PaymentsTrigram");
+    databasePath = filepath;
+    installChangeHooks();
+    publishAllTablesChanged();
+    appliedSettingsVersion = getTableVersion(DbTable::Settings);
     return true;
 }
 
+DatabaseManager *DatabaseManager::getWriterConnection() {
+    if (!db) {
+        return nullptr;
+    }
+    if (!writerConnection) {
+        auto connection = std::make_unique<DatabaseManager>();
+        if (!connection->openSecondary(databasePath)) {
+            std::cerr << "Cannot open writer connection to " << databasePath
+                      << std::endl;
+            return nullptr;
+        }
+        // Общие счётчики и шина подключаются после открытия: открытие
+        // второго соединения с той же базой ничего не меняет для окон
+        connection->tableVersions = tableVersions;
+        connection->changeBus = changeBus;
+        connection->appliedSettingsVersion = getTableVersion(DbTable::Settings);
+        writerConnection = std::move(connection);
+    }
+    return writerConnection.get();
+}
+
+void DatabaseManager::applyConnectionSettings(const Settings &settings) {
+    if (!db)
+        return;
+    // Отрицательный cache_size задаётся в КиБ, а не в страницах
+    execute("PRAGMA cache_size = -" +
+            std::to_string(std::max(settings.db_cache_size_kb, 0)) + ";");
+    execute("PRAGMA mmap_size = " +
+            std::to_string(
+                static_cast<long long>(std::max(settings.db_mmap_size_mb, 0)) *
+                1024 * 1024) +
+            ";");
+    sqlite3_busy_timeout(db, std::max(settings.db_busy_timeout_ms, 0));
+}
+
+void DatabaseManager::refreshConnectionSettings() {
+    // Версии общие с соединением окон, поэтому соединение для записи видит
+    // сохранённые там настройки
+    const unsigned long long version = getTableVersion(DbTable::Settings);
+    if (version != appliedSettingsVersion) {
+        appliedSettingsVersion = version;
+        applyConnectionSettings(getSettings());
+    }
+}
+
 void DatabaseManager::close() {
+    writerConnection.reset();
     if (db) {
+        clearStatementCache();
         sqlite3_close(db);
         db = nullptr;
+        databasePath.clear();
+        pendingChanges.Clear();
+        publishAllTablesChanged();
+    }
+}
+
+unsigned long long DatabaseManager::getTableVersion(DbTable table) const {
+    return (*tableVersions)[static_cast<size_t>(table)];
+}
+
+ChangeBus &DatabaseManager::getChangeBus() { return *changeBus; }
+
+void DatabaseManager::installChangeHooks() {
+    sqlite3_stmt *stmt = nullptr;
+    walMode = false;
+    if (sqlite3_prepare_v2(db, "PRAGMA journal_mode;", -1, &stmt, nullptr) ==
+            SQLITE_OK &&
+        sqlite3_step(stmt) == SQLITE_ROW) {
+        const unsigned char *mode = sqlite3_column_text(stmt, 0);
+        walMode = mode && strcmp(reinterpret_cast<const char *>(mode),
+                                 "wal") == 0;
+    }
+    sqlite3_finalize(stmt);
+
+    sqlite3_update_hook(db, onRowChanged, this);
+    sqlite3_commit_hook(db, onCommit, this);
+    sqlite3_rollback_hook(db, onRollback, this);
+    if (walMode) {
+        sqlite3_wal_hook(db, onWalCommit, this);
     }
 }
 
+void DatabaseManager::publishPendingChanges() {
+    if (pendingChanges.Empty()) {
+        return;
+    }
+    const unsigned tables = pendingChanges.Tables();
+    for (size_t i = 0; i < tableVersions->size(); ++i) {
+        if (tables & (1u << i)) {
+            (*tableVersions)[i]++;
+        }
+    }
+    changeBus->Publish(pendingChanges);
+    pendingChanges.Clear();
+}
+
+void DatabaseManager::publishAllTablesChanged() {
+    DbChangeSet changes;
+    for (size_t i = 0; i < tableVersions->size(); ++i) {
+        (*tableVersions)[i]++;
+        changes.AddReload(static_cast<DbTable>(i));
+    }
+    changeBus->Publish(changes);
+}
+
+void DatabaseManager::onRowChanged(void *self, int op, const char *,
+                                   const char *table, sqlite3_int64 rowid) {
+    int index = tracked_table(table);
+    if (index < 0) {
+        return;
+    }
+    DbChangeKind kind = op == SQLITE_INSERT   ? DbChangeKind::Insert
+                        : op == SQLITE_DELETE ? DbChangeKind::Delete
+                                              : DbChangeKind::Update;
+    static_cast<DatabaseManager *>(self)->pendingChanges.Add(
+        static_cast<DbTable>(index), kind, rowid);
+}
+
+// Хук фиксации вызывается до того, как изменения станут видны другим
+// соединениям, поэтому в режиме WAL версии публикуются в хуке WAL, который
+// вызывается уже после фиксации
+int DatabaseManager::onCommit(void *self) {
+    auto *manager = static_cast<DatabaseManager *>(self);
+    if (!manager->walMode) {
+        manager->publishPendingChanges();
+    }
+    return 0;
+}
+
+void DatabaseManager::onRollback(void *self) {
+    static_cast<DatabaseManager *>(self)->pendingChanges.Clear();
+}
+
+int DatabaseManager::onWalCommit(void *self, sqlite3 *db,
+                                 const char *database, int pages) {
+    static_cast<DatabaseManager *>(self)->publishPendingChanges();
+    if (pages >= WAL_AUTOCHECKPOINT_PAGES) {
+        sqlite3_wal_checkpoint_v2(db, database, SQLITE_CHECKPOINT_PASSIVE,
+                                  nullptr, nullptr);
+    }
+    return SQLITE_OK;
+}
+
 bool DatabaseManager::execute(const std::string &sql) {
     char *errmsg = nullptr;
     int rc = sqlite3_exec(db, sql.c_str(), nullptr, nullptr, &errmsg);
@@ -41,11 +291,270 @@ bool DatabaseManager::execute(const std::string &sql) {
 
 bool DatabaseManager::is_open() const { return db != nullptr; }
 
+bool DatabaseManager::isForeignKeyViolation() const {
+    return db && sqlite3_extended_errcode(db) == SQLITE_CONSTRAINT_FOREIGNKEY;
+}
+
+const std::string &DatabaseManager::getDatabasePath() const {
+    return databasePath;
+}
+
+// Возвращает подготовленный запрос из кэша (сброшенный, без привязок) или
+// компилирует и кэширует новый. Запрос принадлежит кэшу: после использования
+// вызывающий делает sqlite3_reset, а не sqlite3_finalize.
+sqlite3_stmt *DatabaseManager::prepareCached(const std::string &sql) {
+    auto it = statementCache.find(sql);
+    if (it != statementCache.end()) {
+        statementCacheHits++;
+        sqlite3_reset(it->second);
+        sqlite3_clear_bindings(it->second);
+        return it->second;
+    }
+
+    statementCacheMisses++;
+    sqlite3_stmt *stmt = nullptr;
+    int rc = sqlite3_prepare_v3(db, sql.c_str(), -1, SQLITE_PREPARE_PERSISTENT,
+                                &stmt, nullptr);
+    if (rc != SQLITE_OK) {
+        sqlite3_finalize(stmt);
+        return nullptr;
+    }
+    statementCache.emplace(sql, stmt);
+    return stmt;
+}
+
+template <typename Struct, typename Columns>
+bool DatabaseManager::selectRows(const std::string &sql, const Columns &columns,
+                                 std::vector<Struct> &rows, const char *what) {
+    sqlite3_stmt *stmt = prepareCached(sql);
+    if (!stmt) {
+        std::cerr << "Failed to prepare statement for " << what << ": "
+                  << sqlite3_errmsg(db) << std::endl;
+        return false;
+    }
+    bool ok = RowMapper::ReadAll(stmt, columns, rows);
+    if (!ok) {
+        std::cerr << "Failed to select " << what << ": " << sqlite3_errmsg(db)
+                  << std::endl;
+    }
+    sqlite3_reset(stmt);
+    return ok;
+}
+
+template <typename Struct, typename Columns>
+bool DatabaseManager::scanRows(const std::string &sql, const Columns &columns,
+                               const std::function<void(const Struct &)> &visit,
+                               const char *what) {
+    if (!db)
+        return false;
+    sqlite3_stmt *stmt = prepareCached(sql);
+    if (!stmt) {
+        std::cerr << "Failed to prepare statement for " << what << ": "
+                  << sqlite3_errmsg(db) << std::endl;
+        return false;
+    }
+    Struct row{}; // Строки одной структуры: без выделений на каждую запись
+    int rc;
+    while ((rc = sqlite3_step(stmt)) == SQLITE_ROW) {
+        RowMapper::ReadRow(stmt, row, columns);
+        visit(row);
+    }
+    sqlite3_reset(stmt);
+    if (rc != SQLITE_DONE) {
+        std::cerr << "Failed to scan " << what << ": " << sqlite3_errmsg(db)
+                  << std::endl;
+        return false;
+    }
+    return true;
+}
+
+template <typename Struct, typename Columns>
+bool DatabaseManager::selectRowById(const std::string &sql, int id,
+                                    const Columns &columns, Struct &row,
+                                    const char *what) {
+    if (!db)
+        return false;
+    sqlite3_stmt *stmt = prepareCached(sql);
+    if (!stmt) {
+        std::cerr << "Failed to prepare statement for " << what << ": "
+                  << sqlite3_errmsg(db) << std::endl;
+        return false;
+    }
+    sqlite3_bind_int(stmt, 1, id);
+    bool found = false;
+    int rc = sqlite3_step(stmt);
+    if (rc == SQLITE_ROW) {
+        RowMapper::ReadRow(stmt, row, columns);
+        found = true;
+    } else if (rc != SQLITE_DONE) {
+        std::cerr << "Failed to select " << what << ": " << sqlite3_errmsg(db)
+                  << std::endl;
+    }
+    sqlite3_reset(stmt);
+    return found;
+}
+
+void DatabaseManager::clearStatementCache() {
+    for (auto &entry : statementCache) {
+        sqlite3_finalize(entry.second);
+    }
+    statementCache.clear();
+}
+
+size_t DatabaseManager::getStatementCacheHits() const {
+    return statementCacheHits;
+}
+
+size_t DatabaseManager::getStatementCacheMisses() const {
+    return statementCacheMisses;
+}
+
+size_t DatabaseManager::getWriterStatementCacheHits() const {
+    return writerConnection ? writerConnection->getStatementCacheHits() : 0;
+}
+
+size_t DatabaseManager::getWriterStatementCacheMisses() const {
+    return writerConnection ? writerConnection->getStatementCacheMisses() : 0;
+}
+
+bool DatabaseManager::beginTransaction() {
+    if (!db)
+        return false;
+    refreshConnectionSettings();
+    return execute("BEGIN TRANSACTION;");
+}
+
+bool DatabaseManager::commitTransaction() {
+    if (!db)
+        return false;
+    return execute("COMMIT;");
+}
+
+bool DatabaseManager::rollbackTransaction() {
+    if (!db)
+        return false;
+    return execute("ROLLBACK;");
+}
+
+bool DatabaseManager::createSavepoint(const std::string &name) {
+    if (!db)
+        return false;
+    return execute("SAVEPOINT " + name + ";");
+}
+
+bool DatabaseManager::releaseSavepoint(const std::string &name) {
+    if (!db)
+        return false;
+    return execute("RELEASE SAVEPOINT " + name + ";");
+}
+
+bool DatabaseManager::rollbackToSavepoint(const std::string &name) {
+    if (!db)
+        return false;
+    return execute("ROLLBACK TO SAVEPOINT " + name + ";");
+}
+
 bool DatabaseManager::createDatabase(const std::string &filepath) {
-    if (!open(filepath)) {
+    // Таблицы и данные по умолчанию создаются миграциями при открытии файла
+    return open(filepath);
+}
+
+int DatabaseManager::getUserVersion() {
+    sqlite3_stmt *stmt = nullptr;
+    if (sqlite3_prepare_v2(db, "PRAGMA user_version;", -1, &stmt, nullptr) !=
+        SQLITE_OK) {
+        std::cerr << "Failed to read schema version: " << sqlite3_errmsg(db)
+                  << std::endl;
+        return -1;
+    }
+    int version = -1;
+    if (sqlite3_step(stmt) == SQLITE_ROW) {
+        version = sqlite3_column_int(stmt, 0);
+    }
+    sqlite3_finalize(stmt);
+    return version;
+}
+
+bool DatabaseManager::tableExists(const std::string &table) {
+    sqlite3_stmt *stmt = prepareCached(
+        "SELECT 1 FROM sqlite_master WHERE type = 'table' AND name = ?;");
+    if (!stmt) {
+        std::cerr << "Failed to prepare statement: " << sqlite3_errmsg(db)
+                  << std::endl;
         return false;
     }
+    sqlite3_bind_text(stmt, 1, table.c_str(), -1, SQLITE_STATIC);
+    bool exists = sqlite3_step(stmt) == SQLITE_ROW;
+    sqlite3_reset(stmt);
+    return exists;
+}
 
+bool DatabaseManager::columnExists(const std::string &table,
+                                   const std::string &column) {
+    std::string sql = "PRAGMA table_info(" + table + ");";
+    sqlite3_stmt *stmt = nullptr;
+    if (sqlite3_prepare_v2(db, sql.c_str(), -1, &stmt, nullptr) != SQLITE_OK) {
+        std::cerr << "Failed to read columns of " << table << ": "
+                  << sqlite3_errmsg(db) << std::endl;
+        return false;
+    }
+    bool found = false;
+    while (!found && sqlite3_step(stmt) == SQLITE_ROW) {
+        const unsigned char *name = sqlite3_column_text(stmt, 1);
+        found = name && column == (const char *)name;
+    }
+    sqlite3_finalize(stmt);
+    return found;
+}
+
+// Миграции схемы. Версия схемы хранится в PRAGMA user_version: шаг с
+// индексом i переводит базу с версии i на i + 1 в отдельной транзакции.
+// Шаги только дописываются в конец списка, старые не меняются.
+bool DatabaseManager::migrate() {
+    using MigrationStep = bool (DatabaseManager::*)();
+    static const MigrationStep steps[] = {
+        &DatabaseManager::migrateToV1, // Базовая схема и данные по умолчанию
+        &DatabaseManager::migrateToV2, // Индексы для связей и поиска
+        &DatabaseManager::migrateToV3, // Параметры соединения, NULL вместо -1
+        &DatabaseManager::migrateToV4, // Полнотекстовый индекс назначений
+        &DatabaseManager::migrateToV5, // Индексы для постраничной сортировки
+        &DatabaseManager::migrateToV6, // Отпечатки строк выписки
+        &DatabaseManager::migrateToV7, // Контрольные точки импорта
+        &DatabaseManager::migrateToV8, // Настройка снимка платежей
+        &DatabaseManager::migrateToV9, // Индекс триграмм назначений
+    };
+    const int latest_version = sizeof(steps) / sizeof(steps[0]);
+
+    int version = getUserVersion();
+    if (version < 0) {
+        return false;
+    }
+    if (version > latest_version) {
+        std::cerr << "Database schema version " << version
+                  << " is newer than supported " << latest_version
+                  << std::endl;
+        return true;
+    }
+
+    // Не beginTransaction: настройки соединения читаются из ещё не
+    // обновлённой схемы
+    for (int i = version; i < latest_version; ++i) {
+        if (!execute("BEGIN TRANSACTION;")) {
+            return false;
+        }
+        if (!(this->*steps[i])() ||
+            !execute("PRAGMA user_version = " + std::to_string(i + 1) + ";") ||
+            !commitTransaction()) {
+            std::cerr << "Schema migration to version " << i + 1 << " failed"
+                      << std::endl;
+            rollbackTransaction();
+            return false;
+        }
+    }
+    return true;
+}
+
+bool DatabaseManager::migrateToV1() {
     std::vector<std::string> create_tables_sql = {
         // Справочник КОСГУ
         "CREATE TABLE IF NOT EXISTS KOSGU ("
@@ -106,9 +615,6 @@ bool DatabaseManager::createDatabase(const std::string &filepath) {
 
     for (const auto &sql : create_tables_sql) {
         if (!execute(sql)) {
-            // Если одна из таблиц не создалась, закрываем соединение и
-            // возвращаем ошибку
-            close();
             return false;
         }
     }
@@ -121,21 +627,30 @@ bool DatabaseManager::createDatabase(const std::string &filepath) {
         "period_start_date TEXT,"
         "period_end_date TEXT,"
         "note TEXT,"
-        "import_preview_lines INTEGER DEFAULT 20"
+        "import_preview_lines INTEGER DEFAULT 20,"
+        "import_batch_size INTEGER DEFAULT 1000"
         ");";
     if (!execute(create_settings_table_sql)) {
-        close();
         return false;
     }
 
-    // Add the column if it doesn't exist for backward compatibility
-    execute("ALTER TABLE Settings ADD COLUMN import_preview_lines INTEGER DEFAULT 20;");
+    // Базы, созданные до появления этих столбцов
+    if (!columnExists("Settings", "import_preview_lines") &&
+        !execute("ALTER TABLE Settings ADD COLUMN import_preview_lines "
+                 "INTEGER DEFAULT 20;")) {
+        return false;
+    }
+    if (!columnExists("Settings", "import_batch_size") &&
+        !execute("ALTER TABLE Settings ADD COLUMN import_batch_size INTEGER "
+                 "DEFAULT 1000;")) {
+        return false;
+    }
 
     std::string insert_default_settings =
         "INSERT OR IGNORE INTO Settings (id, organization_name, "
-        "period_start_date, period_end_date, note, import_preview_lines) VALUES (1, '', '', '', '', 20);";
+        "period_start_date, period_end_date, note, import_preview_lines, "
+        "import_batch_size) VALUES (1, '', '', '', '', 20, 1000);";
     if (!execute(insert_default_settings)) {
-        close();
         return false;
     }
 
@@ -153,7 +668,6 @@ bool DatabaseManager::createDatabase(const std::string &filepath) {
 
     for (const auto &sql : default_regexes) {
         if (!execute(sql)) {
-            close();
             return false;
         }
     }
@@ -161,23 +675,233 @@ bool DatabaseManager::createDatabase(const std::string &filepath) {
     return true;
 }
 
-// Callback функция для getKosguEntries
-static int kosgu_select_callback(void *data, int argc, char **argv,
-                                 char **azColName) {
-    std::vector<Kosgu> *kosgu_list = static_cast<std::vector<Kosgu> *>(data);
-    Kosgu entry;
-    for (int i = 0; i < argc; i++) {
-        std::string colName = azColName[i];
-        if (colName == "id") {
-            entry.id = argv[i] ? std::stoi(argv[i]) : -1;
-        } else if (colName == "code") {
-            entry.code = argv[i] ? argv[i] : "";
-        } else if (colName == "name") {
-            entry.name = argv[i] ? argv[i] : "";
+bool DatabaseManager::migrateToV2() {
+    // Расшифровки ищутся по платежу и по каждому справочнику; индексы по
+    // справочникам покрывают payment_id и amount для getPaymentInfoFor*.
+    std::vector<std::string> create_indexes_sql = {
+        "CREATE INDEX IF NOT EXISTS idx_payment_details_payment "
+        "ON PaymentDetails(payment_id);",
+        "CREATE INDEX IF NOT EXISTS idx_payment_details_kosgu "
+        "ON PaymentDetails(kosgu_id, payment_id, amount);",
+        "CREATE INDEX IF NOT EXISTS idx_payment_details_contract "
+        "ON PaymentDetails(contract_id, payment_id, amount);",
+        "CREATE INDEX IF NOT EXISTS idx_payment_details_invoice "
+        "ON PaymentDetails(invoice_id, payment_id, amount);",
+        "CREATE INDEX IF NOT EXISTS idx_payments_counterparty "
+        "ON Payments(counterparty_id);",
+        "CREATE INDEX IF NOT EXISTS idx_payments_date ON Payments(date);",
+        "CREATE INDEX IF NOT EXISTS idx_counterparties_name "
+        "ON Counterparties(name);",
+        "CREATE INDEX IF NOT EXISTS idx_contracts_number_date "
+        "ON Contracts(number, date);",
+        "CREATE INDEX IF NOT EXISTS idx_contracts_counterparty "
+        "ON Contracts(counterparty_id);",
+        "CREATE INDEX IF NOT EXISTS idx_invoices_number_date "
+        "ON Invoices(number, date);"};
+
+    for (const auto &sql : create_indexes_sql) {
+        if (!execute(sql)) {
+            return false;
         }
     }
-    kosgu_list->push_back(entry);
-    return 0;
+    return true;
+}
+
+bool DatabaseManager::migrateToV3() {
+    const std::pair<const char *, const char *> connection_columns[] = {
+        {"db_cache_size_kb", "INTEGER DEFAULT 65536"},
+        {"db_mmap_size_mb", "INTEGER DEFAULT 256"},
+        {"db_busy_timeout_ms", "INTEGER DEFAULT 5000"}};
+    for (const auto &column : connection_columns) {
+        if (!columnExists("Settings", column.first) &&
+            !execute(std::string("ALTER TABLE Settings ADD COLUMN ") +
+                     column.first + " " + column.second + ";")) {
+            return false;
+        }
+    }
+
+    // Раньше "не выбрано" сохранялось как -1, что нарушает внешние ключи
+    // при PRAGMA foreign_keys = ON
+    return execute("UPDATE PaymentDetails SET kosgu_id = NULL "
+                   "WHERE kosgu_id = -1;") &&
+           execute("UPDATE PaymentDetails SET contract_id = NULL "
+                   "WHERE contract_id = -1;") &&
+           execute("UPDATE PaymentDetails SET invoice_id = NULL "
+                   "WHERE invoice_id = -1;");
+}
+
+bool DatabaseManager::migrateToV4() {
+    if (!sqlite3_compileoption_used("ENABLE_FTS5")) {
+        std::cerr << "SQLite is built without FTS5, payment search will use "
+                     "LIKE"
+                  << std::endl;
+        return true;
+    }
+
+    // Индекс хранит только токены, сам текст берётся из Payments
+    // (external content); триггеры поддерживают его в актуальном состоянии
+    std::vector<std::string> fts_sql = {
+        "CREATE VIRTUAL TABLE IF NOT EXISTS PaymentsFts USING fts5("
+        "description, content = 'Payments', content_rowid = 'id', "
+        "tokenize = 'unicode61 remove_diacritics 0');",
+
+        "CREATE TRIGGER IF NOT EXISTS payments_fts_insert "
+        "AFTER INSERT ON Payments BEGIN "
+        "INSERT INTO PaymentsFts(rowid, description) "
+        "VALUES (new.id, new.description); END;",
+
+        "CREATE TRIGGER IF NOT EXISTS payments_fts_delete "
+        "AFTER DELETE ON Payments BEGIN "
+        "INSERT INTO PaymentsFts(PaymentsFts, rowid, description) "
+        "VALUES ('delete', old.id, old.description); END;",
+
+        "CREATE TRIGGER IF NOT EXISTS payments_fts_update "
+        "AFTER UPDATE OF description ON Payments BEGIN "
+        "INSERT INTO PaymentsFts(PaymentsFts, rowid, description) "
+        "VALUES ('delete', old.id, old.description); "
+        "INSERT INTO PaymentsFts(rowid, description) "
+        "VALUES (new.id, new.description); END;",
+
+        "INSERT INTO PaymentsFts(PaymentsFts) VALUES ('rebuild');"};
+
+    for (const auto &sql : fts_sql) {
+        if (!execute(sql)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+bool DatabaseManager::migrateToV5() {
+    // Выражение в индексе должно совпадать с ORDER BY в getPaymentsPage
+    return execute("CREATE INDEX IF NOT EXISTS idx_payments_doc_number "
+                   "ON Payments(ifnull(doc_number, ''));") &&
+           execute("CREATE INDEX IF NOT EXISTS idx_payments_amount "
+                   "ON Payments(amount);");
+}
+
+bool DatabaseManager::migrateToV6() {
+    if (!columnExists("Payments", "fingerprint") &&
+        !execute("ALTER TABLE Payments ADD COLUMN fingerprint INTEGER;")) {
+        return false;
+    }
+
+    // Отпечатки уже загруженных платежей считаются так же, как при импорте:
+    // в порядке id, контрагент - по связанной записи
+    sqlite3_stmt *select = nullptr;
+    sqlite3_stmt *update = nullptr;
+    if (sqlite3_prepare_v2(
+            db,
+            "SELECT p.id, p.date, p.doc_number, p.type, p.amount, "
+            "p.recipient, p.description, c.name FROM Payments p "
+            "LEFT JOIN Counterparties c ON c.id = p.counterparty_id "
+            "ORDER BY p.id;",
+            -1, &select, nullptr) != SQLITE_OK ||
+        sqlite3_prepare_v2(db,
+                           "UPDATE Payments SET fingerprint = ? WHERE id = ?;",
+                           -1, &update, nullptr) != SQLITE_OK) {
+        std::cerr << "Failed to prepare fingerprint backfill: "
+                  << sqlite3_errmsg(db) << std::endl;
+        sqlite3_finalize(select);
+        sqlite3_finalize(update);
+        return false;
+    }
+
+    PaymentFingerprint::Sequence sequence;
+    Payment payment;
+    std::string counterparty_name;
+    bool ok = true;
+    int rc = SQLITE_DONE;
+    while (ok && (rc = sqlite3_step(select)) == SQLITE_ROW) {
+        RowMapper::ReadColumn(select, 0, payment.id);
+        RowMapper::ReadColumn(select, 1, payment.date);
+        RowMapper::ReadColumn(select, 2, payment.doc_number);
+        RowMapper::ReadColumn(select, 3, payment.type);
+        RowMapper::ReadColumn(select, 4, payment.amount);
+        RowMapper::ReadColumn(select, 5, payment.recipient);
+        RowMapper::ReadColumn(select, 6, payment.description);
+        RowMapper::ReadColumn(select, 7, counterparty_name);
+
+        sqlite3_bind_int64(update, 1,
+                           sequence.Next(PaymentFingerprint::Content(
+                               payment, counterparty_name)));
+        sqlite3_bind_int(update, 2, payment.id);
+        ok = sqlite3_step(update) == SQLITE_DONE;
+        sqlite3_reset(update);
+    }
+    if (ok && rc != SQLITE_DONE) {
+        ok = false;
+    }
+    if (!ok) {
+        std::cerr << "Fingerprint backfill failed: " << sqlite3_errmsg(db)
+                  << std::endl;
+    }
+    sqlite3_finalize(select);
+    sqlite3_finalize(update);
+
+    return ok && execute("CREATE INDEX IF NOT EXISTS idx_payments_fingerprint "
+                         "ON Payments(fingerprint);");
+}
+
+bool DatabaseManager::migrateToV7() {
+    return execute("CREATE TABLE IF NOT EXISTS ImportCheckpoints ("
+                   "file_path TEXT PRIMARY KEY, "
+                   "file_size INTEGER NOT NULL, "
+                   "file_hash INTEGER NOT NULL, "
+                   "byte_offset INTEGER NOT NULL, "
+                   "rows_committed INTEGER NOT NULL, "
+                   "updated_at TEXT NOT NULL);");
+}
+
+bool DatabaseManager::migrateToV8() {
+    return columnExists("Settings", "payment_snapshot") ||
+           execute("ALTER TABLE Settings ADD COLUMN payment_snapshot INTEGER "
+                   "DEFAULT 1;");
+}
+
+bool DatabaseManager::migrateToV9() {
+    // Токенизатор trigram появился в SQLite 3.34
+    if (!sqlite3_compileoption_used("ENABLE_FTS5") ||
+        sqlite3_libversion_number() < 3034000) {
+        std::cerr << "SQLite has no FTS5 trigram tokenizer, the payment "
+                     "filter will scan the table"
+                  << std::endl;
+        return true;
+    }
+
+    // Для фильтра по подстроке: индекс отбирает назначения со всеми
+    // триграммами запроса, совпадение проверяет instr. Позиции не хранятся
+    // (detail = none), поэтому индекс меньше, чем нужен для фраз
+    std::vector<std::string> trigram_sql = {
+        "CREATE VIRTUAL TABLE IF NOT EXISTS PaymentsTrigram USING fts5("
+        "description, content = 'Payments', content_rowid = 'id', "
+        "tokenize = 'trigram', detail = none);",
+
+        "CREATE TRIGGER IF NOT EXISTS payments_trigram_insert "
+        "AFTER INSERT ON Payments BEGIN "
+        "INSERT INTO PaymentsTrigram(rowid, description) "
+        "VALUES (new.id, new.description); END;",
+
+        "CREATE TRIGGER IF NOT EXISTS payments_trigram_delete "
+        "AFTER DELETE ON Payments BEGIN "
+        "INSERT INTO PaymentsTrigram(PaymentsTrigram, rowid, description) "
+        "VALUES ('delete', old.id, old.description); END;",
+
+        "CREATE TRIGGER IF NOT EXISTS payments_trigram_update "
+        "AFTER UPDATE OF description ON Payments BEGIN "
+        "INSERT INTO PaymentsTrigram(PaymentsTrigram, rowid, description) "
+        "VALUES ('delete', old.id, old.description); "
+        "INSERT INTO PaymentsTrigram(rowid, description) "
+        "VALUES (new.id, new.description); END;",
+
+        "INSERT INTO PaymentsTrigram(PaymentsTrigram) VALUES ('rebuild');"};
+
+    for (const auto &sql : trigram_sql) {
+        if (!execute(sql)) {
+            return false;
+        }
+    }
+    return true;
 }
 
 std::vector<Kosgu> DatabaseManager::getKosguEntries() {
@@ -185,24 +909,21 @@ std::vector<Kosgu> DatabaseManager::getKosguEntries() {
     if (!db)
         return entries;
 
-    std::string sql = "SELECT id, code, name FROM KOSGU;";
-    char *errmsg = nullptr;
-    int rc =
-        sqlite3_exec(db, sql.c_str(), kosgu_select_callback, &entries, &errmsg);
-    if (rc != SQLITE_OK) {
-        std::cerr << "Failed to select KOSGU entries: " << errmsg << std::endl;
-        sqlite3_free(errmsg);
-    }
+    selectRows("SELECT id, code, name FROM KOSGU;", kosgu_columns, entries, "KOSGU entries");
     return entries;
 }
 
+bool DatabaseManager::getKosguById(int id, Kosgu &entry) {
+    return selectRowById("SELECT id, code, name FROM KOSGU WHERE id = ?;", id,
+                         kosgu_columns, entry, "KOSGU entry");
+}
+
 bool DatabaseManager::addKosguEntry(const Kosgu &entry) {
     if (!db)
         return false;
     std::string sql = "INSERT INTO KOSGU (code, name) VALUES (?, ?);";
-    sqlite3_stmt *stmt = nullptr;
-    int rc = sqlite3_prepare_v2(db, sql.c_str(), -1, &stmt, nullptr);
-    if (rc != SQLITE_OK) {
+    sqlite3_stmt *stmt = prepareCached(sql);
+    if (!stmt) {
         std::cerr << "Failed to prepare statement: " << sqlite3_errmsg(db)
                   << std::endl;
         return false;
@@ -210,8 +931,8 @@ bool DatabaseManager::addKosguEntry(const Kosgu &entry) {
     sqlite3_bind_text(stmt, 1, entry.code.c_str(), -1, SQLITE_STATIC);
     sqlite3_bind_text(stmt, 2, entry.name.c_str(), -1, SQLITE_STATIC);
 
-    rc = sqlite3_step(stmt);
-    sqlite3_finalize(stmt);
+    int rc = sqlite3_step(stmt);
+    sqlite3_reset(stmt);
 
     if (rc != SQLITE_DONE) {
         int extended_code = sqlite3_extended_errcode(db);
@@ -227,9 +948,8 @@ bool DatabaseManager::updateKosguEntry(const Kosgu &entry) {
     if (!db)
         return false;
     std::string sql = "UPDATE KOSGU SET code = ?, name = ? WHERE id = ?;";
-    sqlite3_stmt *stmt = nullptr;
-    int rc = sqlite3_prepare_v2(db, sql.c_str(), -1, &stmt, nullptr);
-    if (rc != SQLITE_OK) {
+    sqlite3_stmt *stmt = prepareCached(sql);
+    if (!stmt) {
         std::cerr << "Failed to prepare statement: " << sqlite3_errmsg(db)
                   << std::endl;
         return false;
@@ -238,8 +958,8 @@ bool DatabaseManager::updateKosguEntry(const Kosgu &entry) {
     sqlite3_bind_text(stmt, 2, entry.name.c_str(), -1, SQLITE_STATIC);
     sqlite3_bind_int(stmt, 3, entry.id);
 
-    rc = sqlite3_step(stmt);
-    sqlite3_finalize(stmt);
+    int rc = sqlite3_step(stmt);
+    sqlite3_reset(stmt);
 
     if (rc != SQLITE_DONE) {
         int extended_code = sqlite3_extended_errcode(db);
@@ -255,17 +975,16 @@ bool DatabaseManager::deleteKosguEntry(int id) {
     if (!db)
         return false;
     std::string sql = "DELETE FROM KOSGU WHERE id = ?;";
-    sqlite3_stmt *stmt = nullptr;
-    int rc = sqlite3_prepare_v2(db, sql.c_str(), -1, &stmt, nullptr);
-    if (rc != SQLITE_OK) {
+    sqlite3_stmt *stmt = prepareCached(sql);
+    if (!stmt) {
         std::cerr << "Failed to prepare statement: " << sqlite3_errmsg(db)
                   << std::endl;
         return false;
     }
     sqlite3_bind_int(stmt, 1, id);
 
-    rc = sqlite3_step(stmt);
-    sqlite3_finalize(stmt);
+    int rc = sqlite3_step(stmt);
+    sqlite3_reset(stmt);
 
     if (rc != SQLITE_DONE) {
         int extended_code = sqlite3_extended_errcode(db);
@@ -281,9 +1000,8 @@ int DatabaseManager::getKosguIdByCode(const std::string &code) {
     if (!db)
         return -1;
     std::string sql = "SELECT id FROM KOSGU WHERE code = ?;";
-    sqlite3_stmt *stmt = nullptr;
-    int rc = sqlite3_prepare_v2(db, sql.c_str(), -1, &stmt, nullptr);
-    if (rc != SQLITE_OK) {
+    sqlite3_stmt *stmt = prepareCached(sql);
+    if (!stmt) {
         std::cerr << "Failed to prepare statement for KOSGU lookup by code: "
                   << sqlite3_errmsg(db) << std::endl;
         return -1;
@@ -294,7 +1012,7 @@ int DatabaseManager::getKosguIdByCode(const std::string &code) {
     if (sqlite3_step(stmt) == SQLITE_ROW) {
         id = sqlite3_column_int(stmt, 0);
     }
-    sqlite3_finalize(stmt);
+    sqlite3_reset(stmt);
     return id;
 }
 
@@ -303,9 +1021,8 @@ bool DatabaseManager::addCounterparty(Counterparty &counterparty) {
     if (!db)
         return false;
     std::string sql = "INSERT INTO Counterparties (name, inn) VALUES (?, ?);";
-    sqlite3_stmt *stmt = nullptr;
-    int rc = sqlite3_prepare_v2(db, sql.c_str(), -1, &stmt, nullptr);
-    if (rc != SQLITE_OK) {
+    sqlite3_stmt *stmt = prepareCached(sql);
+    if (!stmt) {
         std::cerr << "Failed to prepare statement: " << sqlite3_errmsg(db)
                   << std::endl;
         return false;
@@ -317,17 +1034,17 @@ bool DatabaseManager::addCounterparty(Counterparty &counterparty) {
         sqlite3_bind_text(stmt, 2, counterparty.inn.c_str(), -1, SQLITE_STATIC);
     }
 
-    rc = sqlite3_step(stmt);
+    int rc = sqlite3_step(stmt);
     if (rc != SQLITE_DONE) {
         int extended_code = sqlite3_extended_errcode(db);
         std::cerr << "Failed to add counterparty: " << sqlite3_errmsg(db)
                   << " (code: " << rc << ", extended code: " << extended_code
                   << ")" << std::endl;
-        sqlite3_finalize(stmt);
+        sqlite3_reset(stmt);
         return false;
     }
     counterparty.id = sqlite3_last_insert_rowid(db);
-    sqlite3_finalize(stmt);
+    sqlite3_reset(stmt);
     return true;
 }
 
@@ -337,9 +1054,8 @@ int DatabaseManager::getCounterpartyIdByNameInn(const std::string &name,
         return -1;
     std::string sql =
         "SELECT id FROM Counterparties WHERE name = ? AND inn = ?;";
-    sqlite3_stmt *stmt = nullptr;
-    int rc = sqlite3_prepare_v2(db, sql.c_str(), -1, &stmt, nullptr);
-    if (rc != SQLITE_OK) {
+    sqlite3_stmt *stmt = prepareCached(sql);
+    if (!stmt) {
         std::cerr << "Failed to prepare statement: " << sqlite3_errmsg(db)
                   << std::endl;
         return -1;
@@ -351,7 +1067,7 @@ int DatabaseManager::getCounterpartyIdByNameInn(const std::string &name,
     if (sqlite3_step(stmt) == SQLITE_ROW) {
         id = sqlite3_column_int(stmt, 0);
     }
-    sqlite3_finalize(stmt);
+    sqlite3_reset(stmt);
     return id;
 }
 
@@ -363,9 +1079,8 @@ int DatabaseManager::getCounterpartyIdByName(const std::string &name) {
                                                                          // for
                                                                          // NULL
                                                                          // INN
-    sqlite3_stmt *stmt = nullptr;
-    int rc = sqlite3_prepare_v2(db, sql.c_str(), -1, &stmt, nullptr);
-    if (rc != SQLITE_OK) {
+    sqlite3_stmt *stmt = prepareCached(sql);
+    if (!stmt) {
         std::cerr
             << "Failed to prepare statement for counterparty lookup by name: "
             << sqlite3_errmsg(db) << std::endl;
@@ -377,55 +1092,33 @@ int DatabaseManager::getCounterpartyIdByName(const std::string &name) {
     if (sqlite3_step(stmt) == SQLITE_ROW) {
         id = sqlite3_column_int(stmt, 0);
     }
-    sqlite3_finalize(stmt);
+    sqlite3_reset(stmt);
     return id;
 }
 
-// Callback функция для getCounterparties
-static int counterparty_select_callback(void *data, int argc, char **argv,
-                                        char **azColName) {
-    std::vector<Counterparty> *counterparty_list =
-        static_cast<std::vector<Counterparty> *>(data);
-    Counterparty entry;
-    for (int i = 0; i < argc; i++) {
-        std::string colName = azColName[i];
-        if (colName == "id") {
-            entry.id = argv[i] ? std::stoi(argv[i]) : -1;
-        } else if (colName == "name") {
-            entry.name = argv[i] ? argv[i] : "";
-        } else if (colName == "inn") {
-            entry.inn = argv[i] ? argv[i] : "";
-        }
-    }
-    counterparty_list->push_back(entry);
-    return 0;
-}
-
 std::vector<Counterparty> DatabaseManager::getCounterparties() {
     std::vector<Counterparty> entries;
     if (!db)
         return entries;
 
-    std::string sql = "SELECT id, name, inn FROM Counterparties;";
-    char *errmsg = nullptr;
-    int rc = sqlite3_exec(db, sql.c_str(), counterparty_select_callback,
-                          &entries, &errmsg);
-    if (rc != SQLITE_OK) {
-        std::cerr << "Failed to select Counterparty entries: " << errmsg
-                  << std::endl;
-        sqlite3_free(errmsg);
-    }
+    selectRows("SELECT id, name, inn FROM Counterparties;", counterparty_columns, entries, "Counterparty entries");
     return entries;
 }
 
+bool DatabaseManager::getCounterpartyById(int id,
+                                          Counterparty &counterparty) {
+    return selectRowById(
+        "SELECT id, name, inn FROM Counterparties WHERE id = ?;", id,
+        counterparty_columns, counterparty, "counterparty");
+}
+
 bool DatabaseManager::updateCounterparty(const Counterparty &counterparty) {
     if (!db)
         return false;
     std::string sql =
         "UPDATE Counterparties SET name = ?, inn = ? WHERE id = ?;";
-    sqlite3_stmt *stmt = nullptr;
-    int rc = sqlite3_prepare_v2(db, sql.c_str(), -1, &stmt, nullptr);
-    if (rc != SQLITE_OK) {
+    sqlite3_stmt *stmt = prepareCached(sql);
+    if (!stmt) {
         std::cerr << "Failed to prepare statement for counterparty update: "
                   << sqlite3_errmsg(db) << std::endl;
         return false;
@@ -438,8 +1131,8 @@ bool DatabaseManager::updateCounterparty(const Counterparty &counterparty) {
     }
     sqlite3_bind_int(stmt, 3, counterparty.id);
 
-    rc = sqlite3_step(stmt);
-    sqlite3_finalize(stmt);
+    int rc = sqlite3_step(stmt);
+    sqlite3_reset(stmt);
 
     if (rc != SQLITE_DONE) {
         std::cerr << "Failed to update Counterparty entry: "
@@ -453,17 +1146,16 @@ bool DatabaseManager::deleteCounterparty(int id) {
     if (!db)
         return false;
     std::string sql = "DELETE FROM Counterparties WHERE id = ?;";
-    sqlite3_stmt *stmt = nullptr;
-    int rc = sqlite3_prepare_v2(db, sql.c_str(), -1, &stmt, nullptr);
-    if (rc != SQLITE_OK) {
+    sqlite3_stmt *stmt = prepareCached(sql);
+    if (!stmt) {
         std::cerr << "Failed to prepare statement: " << sqlite3_errmsg(db)
                   << std::endl;
         return false;
     }
     sqlite3_bind_int(stmt, 1, id);
 
-    rc = sqlite3_step(stmt);
-    sqlite3_finalize(stmt);
+    int rc = sqlite3_step(stmt);
+    sqlite3_reset(stmt);
 
     if (rc != SQLITE_DONE) {
         std::cerr << "Failed to delete Counterparty entry: "
@@ -485,8 +1177,8 @@ DatabaseManager::getPaymentInfoForCounterparty(int counterparty_id) {
                       "JOIN Contracts c ON pd.contract_id = c.id "
                       "WHERE c.counterparty_id = ?;";
 
-    sqlite3_stmt *stmt = nullptr;
-    if (sqlite3_prepare_v2(db, sql.c_str(), -1, &stmt, nullptr) != SQLITE_OK) {
+    sqlite3_stmt *stmt = prepareCached(sql);
+    if (!stmt) {
         std::cerr
             << "Failed to prepare statement for getPaymentInfoForCounterparty: "
             << sqlite3_errmsg(db) << std::endl;
@@ -495,16 +1187,9 @@ DatabaseManager::getPaymentInfoForCounterparty(int counterparty_id) {
 
     sqlite3_bind_int(stmt, 1, counterparty_id);
 
-    while (sqlite3_step(stmt) == SQLITE_ROW) {
-        ContractPaymentInfo info;
-        info.date = (const char *)sqlite3_column_text(stmt, 0);
-        info.doc_number = (const char *)sqlite3_column_text(stmt, 1);
-        info.amount = sqlite3_column_double(stmt, 2);
-        info.description = (const char *)sqlite3_column_text(stmt, 3);
-        results.push_back(info);
-    }
+    RowMapper::ReadAll(stmt, payment_info_columns, results);
 
-    sqlite3_finalize(stmt);
+    sqlite3_reset(stmt);
     return results;
 }
 
@@ -514,9 +1199,8 @@ bool DatabaseManager::addContract(Contract &contract) {
         return false;
     std::string sql = "INSERT INTO Contracts (number, date, counterparty_id) "
                       "VALUES (?, ?, ?);";
-    sqlite3_stmt *stmt = nullptr;
-    int rc = sqlite3_prepare_v2(db, sql.c_str(), -1, &stmt, nullptr);
-    if (rc != SQLITE_OK) {
+    sqlite3_stmt *stmt = prepareCached(sql);
+    if (!stmt) {
         std::cerr << "Failed to prepare statement: " << sqlite3_errmsg(db)
                   << std::endl;
         return false;
@@ -529,17 +1213,17 @@ bool DatabaseManager::addContract(Contract &contract) {
         sqlite3_bind_null(stmt, 3);
     }
 
-    rc = sqlite3_step(stmt);
+    int rc = sqlite3_step(stmt);
     if (rc != SQLITE_DONE) {
         int extended_code = sqlite3_extended_errcode(db);
         std::cerr << "Failed to add contract: " << sqlite3_errmsg(db)
                   << " (code: " << rc << ", extended code: " << extended_code
                   << ")" << std::endl;
-        sqlite3_finalize(stmt);
+        sqlite3_reset(stmt);
         return false;
     }
     contract.id = sqlite3_last_insert_rowid(db);
-    sqlite3_finalize(stmt);
+    sqlite3_reset(stmt);
     return true;
 }
 
@@ -548,9 +1232,8 @@ int DatabaseManager::getContractIdByNumberDate(const std::string &number,
     if (!db)
         return -1;
     std::string sql = "SELECT id FROM Contracts WHERE number = ? AND date = ?;";
-    sqlite3_stmt *stmt = nullptr;
-    int rc = sqlite3_prepare_v2(db, sql.c_str(), -1, &stmt, nullptr);
-    if (rc != SQLITE_OK) {
+    sqlite3_stmt *stmt = prepareCached(sql);
+    if (!stmt) {
         std::cerr << "Failed to prepare statement: " << sqlite3_errmsg(db)
                   << std::endl;
         return -1;
@@ -562,58 +1245,32 @@ int DatabaseManager::getContractIdByNumberDate(const std::string &number,
     if (sqlite3_step(stmt) == SQLITE_ROW) {
         id = sqlite3_column_int(stmt, 0);
     }
-    sqlite3_finalize(stmt);
+    sqlite3_reset(stmt);
     return id;
 }
 
-// Callback функция для getContracts
-static int contract_select_callback(void *data, int argc, char **argv,
-                                    char **azColName) {
-    std::vector<Contract> *contract_list =
-        static_cast<std::vector<Contract> *>(data);
-    Contract entry;
-    for (int i = 0; i < argc; i++) {
-        std::string colName = azColName[i];
-        if (colName == "id") {
-            entry.id = argv[i] ? std::stoi(argv[i]) : -1;
-        } else if (colName == "number") {
-            entry.number = argv[i] ? argv[i] : "";
-        } else if (colName == "date") {
-            entry.date = argv[i] ? argv[i] : "";
-        } else if (colName == "counterparty_id") {
-            entry.counterparty_id = argv[i] ? std::stoi(argv[i]) : -1;
-        }
-    }
-    contract_list->push_back(entry);
-    return 0;
-}
-
 std::vector<Contract> DatabaseManager::getContracts() {
     std::vector<Contract> entries;
     if (!db)
         return entries;
 
-    std::string sql =
-        "SELECT id, number, date, counterparty_id FROM Contracts;";
-    char *errmsg = nullptr;
-    int rc = sqlite3_exec(db, sql.c_str(), contract_select_callback, &entries,
-                          &errmsg);
-    if (rc != SQLITE_OK) {
-        std::cerr << "Failed to select Contract entries: " << errmsg
-                  << std::endl;
-        sqlite3_free(errmsg);
-    }
+    selectRows("SELECT id, number, date, counterparty_id FROM Contracts;", contract_columns, entries, "Contract entries");
     return entries;
 }
 
+bool DatabaseManager::getContractById(int id, Contract &contract) {
+    return selectRowById("SELECT id, number, date, counterparty_id FROM "
+                         "Contracts WHERE id = ?;",
+                         id, contract_columns, contract, "contract");
+}
+
 bool DatabaseManager::updateContract(const Contract &contract) {
     if (!db)
         return false;
     std::string sql = "UPDATE Contracts SET number = ?, date = ?, "
                       "counterparty_id = ? WHERE id = ?;";
-    sqlite3_stmt *stmt = nullptr;
-    int rc = sqlite3_prepare_v2(db, sql.c_str(), -1, &stmt, nullptr);
-    if (rc != SQLITE_OK) {
+    sqlite3_stmt *stmt = prepareCached(sql);
+    if (!stmt) {
         std::cerr << "Failed to prepare statement for contract update: "
                   << sqlite3_errmsg(db) << std::endl;
         return false;
@@ -628,7 +1285,7 @@ bool DatabaseManager::updateContract(const Contract &contract) {
     sqlite3_bind_int(stmt, 4, contract.id);
 
     int rc_step = sqlite3_step(stmt);
-    sqlite3_finalize(stmt);
+    sqlite3_reset(stmt);
 
     if (rc_step != SQLITE_DONE) {
         std::cerr << "Failed to update Contract entry: " << sqlite3_errmsg(db)
@@ -642,9 +1299,8 @@ bool DatabaseManager::deleteContract(int id) {
     if (!db)
         return false;
     std::string sql = "DELETE FROM Contracts WHERE id = ?;";
-    sqlite3_stmt *stmt = nullptr;
-    int rc = sqlite3_prepare_v2(db, sql.c_str(), -1, &stmt, nullptr);
-    if (rc != SQLITE_OK) {
+    sqlite3_stmt *stmt = prepareCached(sql);
+    if (!stmt) {
         std::cerr << "Failed to prepare statement: " << sqlite3_errmsg(db)
                   << std::endl;
         return false;
@@ -652,7 +1308,7 @@ bool DatabaseManager::deleteContract(int id) {
     sqlite3_bind_int(stmt, 1, id);
 
     int rc_step = sqlite3_step(stmt);
-    sqlite3_finalize(stmt);
+    sqlite3_reset(stmt);
 
     if (rc_step != SQLITE_DONE) {
         std::cerr << "Failed to delete Contract entry: " << sqlite3_errmsg(db)
@@ -673,8 +1329,8 @@ DatabaseManager::getPaymentInfoForContract(int contract_id) {
                       "JOIN PaymentDetails pd ON p.id = pd.payment_id "
                       "WHERE pd.contract_id = ?;";
 
-    sqlite3_stmt *stmt = nullptr;
-    if (sqlite3_prepare_v2(db, sql.c_str(), -1, &stmt, nullptr) != SQLITE_OK) {
+    sqlite3_stmt *stmt = prepareCached(sql);
+    if (!stmt) {
         std::cerr
             << "Failed to prepare statement for getPaymentInfoForContract: "
             << sqlite3_errmsg(db) << std::endl;
@@ -683,16 +1339,9 @@ DatabaseManager::getPaymentInfoForContract(int contract_id) {
 
     sqlite3_bind_int(stmt, 1, contract_id);
 
-    while (sqlite3_step(stmt) == SQLITE_ROW) {
-        ContractPaymentInfo info;
-        info.date = (const char *)sqlite3_column_text(stmt, 0);
-        info.doc_number = (const char *)sqlite3_column_text(stmt, 1);
-        info.amount = sqlite3_column_double(stmt, 2);
-        info.description = (const char *)sqlite3_column_text(stmt, 3);
-        results.push_back(info);
-    }
+    RowMapper::ReadAll(stmt, payment_info_columns, results);
 
-    sqlite3_finalize(stmt);
+    sqlite3_reset(stmt);
     return results;
 }
 
@@ -702,9 +1351,8 @@ bool DatabaseManager::addInvoice(Invoice &invoice) {
         return false;
     std::string sql =
         "INSERT INTO Invoices (number, date, contract_id) VALUES (?, ?, ?);";
-    sqlite3_stmt *stmt = nullptr;
-    int rc = sqlite3_prepare_v2(db, sql.c_str(), -1, &stmt, nullptr);
-    if (rc != SQLITE_OK) {
+    sqlite3_stmt *stmt = prepareCached(sql);
+    if (!stmt) {
         std::cerr << "Failed to prepare statement: " << sqlite3_errmsg(db)
                   << std::endl;
         return false;
@@ -717,15 +1365,15 @@ bool DatabaseManager::addInvoice(Invoice &invoice) {
         sqlite3_bind_null(stmt, 3);
     }
 
-    rc = sqlite3_step(stmt);
+    int rc = sqlite3_step(stmt);
     if (rc != SQLITE_DONE) {
         std::cerr << "Failed to add invoice: " << sqlite3_errmsg(db)
                   << std::endl;
-        sqlite3_finalize(stmt);
+        sqlite3_reset(stmt);
         return false;
     }
     invoice.id = sqlite3_last_insert_rowid(db);
-    sqlite3_finalize(stmt);
+    sqlite3_reset(stmt);
     return true;
 }
 
@@ -734,9 +1382,8 @@ int DatabaseManager::getInvoiceIdByNumberDate(const std::string &number,
     if (!db)
         return -1;
     std::string sql = "SELECT id FROM Invoices WHERE number = ? AND date = ?;";
-    sqlite3_stmt *stmt = nullptr;
-    int rc = sqlite3_prepare_v2(db, sql.c_str(), -1, &stmt, nullptr);
-    if (rc != SQLITE_OK) {
+    sqlite3_stmt *stmt = prepareCached(sql);
+    if (!stmt) {
         std::cerr << "Failed to prepare statement: " << sqlite3_errmsg(db)
                   << std::endl;
         return -1;
@@ -748,57 +1395,32 @@ int DatabaseManager::getInvoiceIdByNumberDate(const std::string &number,
     if (sqlite3_step(stmt) == SQLITE_ROW) {
         id = sqlite3_column_int(stmt, 0);
     }
-    sqlite3_finalize(stmt);
+    sqlite3_reset(stmt);
     return id;
 }
 
-// Callback функция для getInvoices
-static int invoice_select_callback(void *data, int argc, char **argv,
-                                   char **azColName) {
-    std::vector<Invoice> *invoice_list =
-        static_cast<std::vector<Invoice> *>(data);
-    Invoice entry;
-    for (int i = 0; i < argc; i++) {
-        std::string colName = azColName[i];
-        if (colName == "id") {
-            entry.id = argv[i] ? std::stoi(argv[i]) : -1;
-        } else if (colName == "number") {
-            entry.number = argv[i] ? argv[i] : "";
-        } else if (colName == "date") {
-            entry.date = argv[i] ? argv[i] : "";
-        } else if (colName == "contract_id") {
-            entry.contract_id = argv[i] ? std::stoi(argv[i]) : -1;
-        }
-    }
-    invoice_list->push_back(entry);
-    return 0;
-}
-
 std::vector<Invoice> DatabaseManager::getInvoices() {
     std::vector<Invoice> entries;
     if (!db)
         return entries;
-
-    std::string sql = "SELECT id, number, date, contract_id FROM Invoices;";
-    char *errmsg = nullptr;
-    int rc = sqlite3_exec(db, sql.c_str(), invoice_select_callback, &entries,
-                          &errmsg);
-    if (rc != SQLITE_OK) {
-        std::cerr << "Failed to select Invoice entries: " << errmsg
-                  << std::endl;
-        sqlite3_free(errmsg);
-    }
+
+    selectRows("SELECT id, number, date, contract_id FROM Invoices;", invoice_columns, entries, "Invoice entries");
     return entries;
 }
 
+bool DatabaseManager::getInvoiceById(int id, Invoice &invoice) {
+    return selectRowById("SELECT id, number, date, contract_id FROM Invoices "
+                         "WHERE id = ?;",
+                         id, invoice_columns, invoice, "invoice");
+}
+
 bool DatabaseManager::updateInvoice(const Invoice &invoice) {
     if (!db)
         return false;
     std::string sql = "UPDATE Invoices SET number = ?, date = ?, contract_id = "
                       "? WHERE id = ?;";
-    sqlite3_stmt *stmt = nullptr;
-    int rc = sqlite3_prepare_v2(db, sql.c_str(), -1, &stmt, nullptr);
-    if (rc != SQLITE_OK) {
+    sqlite3_stmt *stmt = prepareCached(sql);
+    if (!stmt) {
         std::cerr << "Failed to prepare statement for invoice update: "
                   << sqlite3_errmsg(db) << std::endl;
         return false;
@@ -813,7 +1435,7 @@ bool DatabaseManager::updateInvoice(const Invoice &invoice) {
     sqlite3_bind_int(stmt, 4, invoice.id);
 
     int rc_step = sqlite3_step(stmt);
-    sqlite3_finalize(stmt);
+    sqlite3_reset(stmt);
 
     if (rc_step != SQLITE_DONE) {
         std::cerr << "Failed to update Invoice entry: " << sqlite3_errmsg(db)
@@ -827,9 +1449,8 @@ bool DatabaseManager::deleteInvoice(int id) {
     if (!db)
         return false;
     std::string sql = "DELETE FROM Invoices WHERE id = ?;";
-    sqlite3_stmt *stmt = nullptr;
-    int rc = sqlite3_prepare_v2(db, sql.c_str(), -1, &stmt, nullptr);
-    if (rc != SQLITE_OK) {
+    sqlite3_stmt *stmt = prepareCached(sql);
+    if (!stmt) {
         std::cerr << "Failed to prepare statement: " << sqlite3_errmsg(db)
                   << std::endl;
         return false;
@@ -837,7 +1458,7 @@ bool DatabaseManager::deleteInvoice(int id) {
     sqlite3_bind_int(stmt, 1, id);
 
     int rc_step = sqlite3_step(stmt);
-    sqlite3_finalize(stmt);
+    sqlite3_reset(stmt);
 
     if (rc_step != SQLITE_DONE) {
         std::cerr << "Failed to delete Invoice entry: " << sqlite3_errmsg(db)
@@ -858,8 +1479,8 @@ DatabaseManager::getPaymentInfoForInvoice(int invoice_id) {
                       "JOIN PaymentDetails pd ON p.id = pd.payment_id "
                       "WHERE pd.invoice_id = ?;";
 
-    sqlite3_stmt *stmt = nullptr;
-    if (sqlite3_prepare_v2(db, sql.c_str(), -1, &stmt, nullptr) != SQLITE_OK) {
+    sqlite3_stmt *stmt = prepareCached(sql);
+    if (!stmt) {
         std::cerr
             << "Failed to prepare statement for getPaymentInfoForInvoice: "
             << sqlite3_errmsg(db) << std::endl;
@@ -868,16 +1489,9 @@ DatabaseManager::getPaymentInfoForInvoice(int invoice_id) {
 
     sqlite3_bind_int(stmt, 1, invoice_id);
 
-    while (sqlite3_step(stmt) == SQLITE_ROW) {
-        ContractPaymentInfo info;
-        info.date = (const char *)sqlite3_column_text(stmt, 0);
-        info.doc_number = (const char *)sqlite3_column_text(stmt, 1);
-        info.amount = sqlite3_column_double(stmt, 2);
-        info.description = (const char *)sqlite3_column_text(stmt, 3);
-        results.push_back(info);
-    }
+    RowMapper::ReadAll(stmt, payment_info_columns, results);
 
-    sqlite3_finalize(stmt);
+    sqlite3_reset(stmt);
     return results;
 }
 
@@ -892,11 +1506,10 @@ bool DatabaseManager::addPayment(Payment &payment) {
     //           << ", Desc: " << payment.description << std::endl;
 
     std::string sql = "INSERT INTO Payments (date, doc_number, type, amount, "
-                      "recipient, description, counterparty_id) "
-                      "VALUES (?, ?, ?, ?, ?, ?, ?);";
-    sqlite3_stmt *stmt = nullptr;
-    int rc = sqlite3_prepare_v2(db, sql.c_str(), -1, &stmt, nullptr);
-    if (rc != SQLITE_OK) {
+                      "recipient, description, counterparty_id, fingerprint) "
+                      "VALUES (?, ?, ?, ?, ?, ?, ?, ?);";
+    sqlite3_stmt *stmt = prepareCached(sql);
+    if (!stmt) {
         std::cerr << "Failed to prepare statement: " << sqlite3_errmsg(db)
                   << std::endl;
         return false;
@@ -912,47 +1525,50 @@ bool DatabaseManager::addPayment(Payment &payment) {
     } else {
         sqlite3_bind_null(stmt, 7);
     }
+    if (payment.fingerprint != 0) {
+        sqlite3_bind_int64(stmt, 8, payment.fingerprint);
+    } else {
+        sqlite3_bind_null(stmt, 8);
+    }
 
-    rc = sqlite3_step(stmt);
+    int rc = sqlite3_step(stmt);
     if (rc != SQLITE_DONE) {
         int extended_code = sqlite3_extended_errcode(db);
         std::cerr << "Failed to add payment: " << sqlite3_errmsg(db)
                   << " (code: " << rc << ", extended code: " << extended_code
                   << ")" << std::endl;
-        sqlite3_finalize(stmt);
+        sqlite3_reset(stmt);
         return false;
     }
     payment.id = sqlite3_last_insert_rowid(db);
-    sqlite3_finalize(stmt);
+    sqlite3_reset(stmt);
     return true;
 }
 
-// Callback for getPayments
-static int payment_select_callback(void *data, int argc, char **argv,
-                                   char **azColName) {
-    auto *payments = static_cast<std::vector<Payment> *>(data);
-    Payment p;
-    for (int i = 0; i < argc; i++) {
-        std::string colName = azColName[i];
-        if (colName == "id")
-            p.id = argv[i] ? std::stoi(argv[i]) : -1;
-        else if (colName == "date")
-            p.date = argv[i] ? argv[i] : "";
-        else if (colName == "doc_number")
-            p.doc_number = argv[i] ? argv[i] : "";
-        else if (colName == "type")
-            p.type = argv[i] ? argv[i] : "";
-        else if (colName == "amount")
-            p.amount = argv[i] ? std::stod(argv[i]) : 0.0;
-        else if (colName == "recipient")
-            p.recipient = argv[i] ? argv[i] : "";
-        else if (colName == "description")
-            p.description = argv[i] ? argv[i] : "";
-        else if (colName == "counterparty_id")
-            p.counterparty_id = argv[i] ? std::stoi(argv[i]) : -1;
-    }
-    payments->push_back(p);
-    return 0;
+bool DatabaseManager::getPaymentFingerprints(
+    std::unordered_set<long long> &fingerprints) {
+    if (!db)
+        return false;
+    // Читается только индекс idx_payments_fingerprint
+    std::string sql = "SELECT fingerprint FROM Payments "
+                      "WHERE fingerprint IS NOT NULL;";
+    sqlite3_stmt *stmt = prepareCached(sql);
+    if (!stmt) {
+        std::cerr << "Failed to prepare statement for payment fingerprints: "
+                  << sqlite3_errmsg(db) << std::endl;
+        return false;
+    }
+    int rc;
+    while ((rc = sqlite3_step(stmt)) == SQLITE_ROW) {
+        fingerprints.insert(sqlite3_column_int64(stmt, 0));
+    }
+    sqlite3_reset(stmt);
+    if (rc != SQLITE_DONE) {
+        std::cerr << "Failed to read payment fingerprints: "
+                  << sqlite3_errmsg(db) << std::endl;
+        return false;
+    }
+    return true;
 }
 
 std::vector<Payment> DatabaseManager::getPayments() {
@@ -960,18 +1576,25 @@ std::vector<Payment> DatabaseManager::getPayments() {
     if (!db)
         return payments;
 
-    std::string sql = "SELECT id, date, doc_number, type, amount, recipient, "
-                      "description, counterparty_id FROM Payments;";
-    char *errmsg = nullptr;
-    int rc = sqlite3_exec(db, sql.c_str(), payment_select_callback, &payments,
-                          &errmsg);
-    if (rc != SQLITE_OK) {
-        std::cerr << "Failed to select Payments: " << errmsg << std::endl;
-        sqlite3_free(errmsg);
-    }
+    selectRows("SELECT id, date, doc_number, type, amount, recipient, "
+                      "description, counterparty_id FROM Payments;", payment_columns, payments, "Payments");
     return payments;
 }
 
+bool DatabaseManager::forEachPayment(
+    const std::function<void(const Payment &)> &visit) {
+    return scanRows("SELECT id, date, doc_number, type, amount, recipient, "
+                    "description, counterparty_id FROM Payments;",
+                    payment_columns, visit, "Payments");
+}
+
+bool DatabaseManager::getPaymentById(int id, Payment &payment) {
+    return selectRowById("SELECT id, date, doc_number, type, amount, "
+                         "recipient, description, counterparty_id FROM "
+                         "Payments WHERE id = ?;",
+                         id, payment_columns, payment, "payment");
+}
+
 bool DatabaseManager::updatePayment(const Payment &payment) {
     if (!db)
         return false;
@@ -979,9 +1602,8 @@ bool DatabaseManager::updatePayment(const Payment &payment) {
         "UPDATE Payments SET date = ?, doc_number = ?, type = ?, amount = ?, "
         "recipient = ?, description = ?, counterparty_id = ? "
         "WHERE id = ?;";
-    sqlite3_stmt *stmt = nullptr;
-    int rc = sqlite3_prepare_v2(db, sql.c_str(), -1, &stmt, nullptr);
-    if (rc != SQLITE_OK) {
+    sqlite3_stmt *stmt = prepareCached(sql);
+    if (!stmt) {
         std::cerr << "Failed to prepare statement for payment update: "
                   << sqlite3_errmsg(db) << std::endl;
         return false;
@@ -999,8 +1621,8 @@ bool DatabaseManager::updatePayment(const Payment &payment) {
     }
     sqlite3_bind_int(stmt, 8, payment.id);
 
-    rc = sqlite3_step(stmt);
-    sqlite3_finalize(stmt);
+    int rc = sqlite3_step(stmt);
+    sqlite3_reset(stmt);
 
     if (rc != SQLITE_DONE) {
         int extended_code = sqlite3_extended_errcode(db);
@@ -1016,17 +1638,16 @@ bool DatabaseManager::deletePayment(int id) {
     if (!db)
         return false;
     std::string sql = "DELETE FROM Payments WHERE id = ?;";
-    sqlite3_stmt *stmt = nullptr;
-    int rc = sqlite3_prepare_v2(db, sql.c_str(), -1, &stmt, nullptr);
-    if (rc != SQLITE_OK) {
+    sqlite3_stmt *stmt = prepareCached(sql);
+    if (!stmt) {
         std::cerr << "Failed to prepare statement for payment delete: "
                   << sqlite3_errmsg(db) << std::endl;
         return false;
     }
     sqlite3_bind_int(stmt, 1, id);
 
-    rc = sqlite3_step(stmt);
-    sqlite3_finalize(stmt);
+    int rc = sqlite3_step(stmt);
+    sqlite3_reset(stmt);
 
     if (rc != SQLITE_DONE) {
         int extended_code = sqlite3_extended_errcode(db);
@@ -1049,8 +1670,8 @@ DatabaseManager::getPaymentInfoForKosgu(int kosgu_id) {
                       "JOIN PaymentDetails pd ON p.id = pd.payment_id "
                       "WHERE pd.kosgu_id = ?;";
 
-    sqlite3_stmt *stmt = nullptr;
-    if (sqlite3_prepare_v2(db, sql.c_str(), -1, &stmt, nullptr) != SQLITE_OK) {
+    sqlite3_stmt *stmt = prepareCached(sql);
+    if (!stmt) {
         std::cerr << "Failed to prepare statement for getPaymentInfoForKosgu: "
                   << sqlite3_errmsg(db) << std::endl;
         return results;
@@ -1058,16 +1679,410 @@ DatabaseManager::getPaymentInfoForKosgu(int kosgu_id) {
 
     sqlite3_bind_int(stmt, 1, kosgu_id);
 
-    while (sqlite3_step(stmt) == SQLITE_ROW) {
-        ContractPaymentInfo info;
-        info.date = (const char *)sqlite3_column_text(stmt, 0);
-        info.doc_number = (const char *)sqlite3_column_text(stmt, 1);
-        info.amount = sqlite3_column_double(stmt, 2);
-        info.description = (const char *)sqlite3_column_text(stmt, 3);
-        results.push_back(info);
+    RowMapper::ReadAll(stmt, payment_info_columns, results);
+
+    sqlite3_reset(stmt);
+    return results;
+}
+
+// Превращает пользовательский ввод в запрос FTS5: каждое слово берётся в
+// кавычки (операторы и спецсимволы FTS5 не интерпретируются) и ищется по
+// префиксу, слова объединяются через AND
+static std::string build_fts_query(const std::string &text) {
+    std::string query;
+    size_t pos = 0;
+    while (pos < text.size()) {
+        size_t start = text.find_first_not_of(" \t\r\n", pos);
+        if (start == std::string::npos)
+            break;
+        size_t end = text.find_first_of(" \t\r\n", start);
+        if (end == std::string::npos)
+            end = text.size();
+
+        if (!query.empty())
+            query += ' ';
+        query += '"';
+        for (size_t i = start; i < end; ++i) {
+            if (text[i] == '"')
+                query += '"';
+            query += text[i];
+        }
+        query += "\"*";
+        pos = end;
+    }
+    return query;
+}
+
+static const char *payment_sort_expression(PaymentSortColumn column) {
+    switch (column) {
+    case PaymentSortColumn::DocNumber:
+        return "ifnull(doc_number, '')";
+    case PaymentSortColumn::Amount:
+        return "amount";
+    case PaymentSortColumn::Description:
+        return "ifnull(description, '')";
+    case PaymentSortColumn::Date:
+    default:
+        return "date";
     }
+}
 
-    sqlite3_finalize(stmt);
+// Запрос MATCH к PaymentsTrigram: все различные триграммы символов
+// строки, каждая в кавычках, через AND. Пустой, если символов меньше трёх
+static std::string build_trigram_query(const std::string &text) {
+    std::vector<size_t> starts; // Начала символов UTF-8
+    for (size_t i = 0; i < text.size(); ++i) {
+        if ((static_cast<unsigned char>(text[i]) & 0xC0) != 0x80)
+            starts.push_back(i);
+    }
+    starts.push_back(text.size());
+
+    std::vector<std::string> trigrams;
+    for (size_t i = 0; i + 3 < starts.size(); ++i) {
+        trigrams.push_back(text.substr(starts[i], starts[i + 3] - starts[i]));
+    }
+    std::sort(trigrams.begin(), trigrams.end());
+    trigrams.erase(std::unique(trigrams.begin(), trigrams.end()),
+                   trigrams.end());
+
+    std::string query;
+    for (const auto &trigram : trigrams) {
+        if (!query.empty())
+            query += ' ';
+        query += '"';
+        for (char c : trigram) {
+            if (c == '"')
+                query += '"';
+            query += c;
+        }
+        query += '"';
+    }
+    return query;
+}
+
+// Фильтр по назначению - подстрока без учёта регистра, как в режиме "в
+// памяти". Индекс триграмм, если он есть, отбирает кандидатов, а каждую
+// строку окончательно проверяет instr по casefold; запрос короче трёх
+// символов проверяется только перебором
+struct PaymentFilter {
+    std::string folded;   // Пустая - фильтра нет
+    std::string trigrams; // Пустая - без индекса
+};
+
+static PaymentFilter payment_filter(const PaymentPageQuery &query,
+                                    bool trigram_index) {
+    PaymentFilter filter;
+    filter.folded = Utf8::FoldCase(query.filter);
+    if (trigram_index) {
+        filter.trigrams = build_trigram_query(filter.folded);
+    }
+    return filter;
+}
+
+// Общая часть WHERE для постраничных запросов: фильтр по назначению и
+// условие "после ключа" в порядке сортировки
+static std::string payment_page_where(const PaymentPageQuery &query,
+                                      const PaymentFilter &filter,
+                                      bool has_after) {
+    std::string where;
+    if (!filter.trigrams.empty()) {
+        where += "id IN (SELECT rowid FROM PaymentsTrigram "
+                 "WHERE PaymentsTrigram MATCH ?) AND ";
+    }
+    if (!filter.folded.empty()) {
+        where += "instr(casefold(description), ?) > 0";
+    }
+    if (has_after) {
+        if (!where.empty())
+            where += " AND ";
+        // Отдельное условие на столбец сортировки позволяет SQLite начать
+        // поиск по индексу (по сравнению строк-значений с выражением он
+        // индекс не использует)
+        const std::string column = payment_sort_expression(query.sort_column);
+        const char *op = query.descending ? "<" : ">";
+        where += column + " " + op + "= ? AND (" + column + ", id) " + op +
+                 " (?, ?)";
+    }
+    return where.empty() ? "" : " WHERE " + where;
+}
+
+static std::string payment_page_order(const PaymentPageQuery &query) {
+    const char *direction = query.descending ? " DESC" : " ASC";
+    return std::string(" ORDER BY ") +
+           payment_sort_expression(query.sort_column) + direction + ", id" +
+           direction;
+}
+
+// Привязывает фильтр и ключ; возвращает индекс следующего параметра
+static int bind_payment_page(sqlite3_stmt *stmt, const PaymentPageQuery &query,
+                             const PaymentFilter &filter,
+                             const PaymentPageKey *after) {
+    int index = 1;
+    if (!filter.trigrams.empty()) {
+        sqlite3_bind_text(stmt, index++, filter.trigrams.c_str(), -1,
+                          SQLITE_STATIC);
+    }
+    if (!filter.folded.empty()) {
+        sqlite3_bind_text(stmt, index++, filter.folded.c_str(), -1,
+                          SQLITE_STATIC);
+    }
+    if (after) {
+        for (int i = 0; i < 2; ++i) {
+            if (query.sort_column == PaymentSortColumn::Amount) {
+                sqlite3_bind_double(stmt, index++, after->number_value);
+            } else {
+                sqlite3_bind_text(stmt, index++, after->text_value.c_str(), -1,
+                                  SQLITE_STATIC);
+            }
+        }
+        sqlite3_bind_int(stmt, index++, after->id);
+    }
+    return index;
+}
+
+static void read_payment_page_key(sqlite3_stmt *stmt, int index,
+                                  PaymentSortColumn column,
+                                  PaymentPageKey &key) {
+    if (column == PaymentSortColumn::Amount) {
+        RowMapper::ReadColumn(stmt, index, key.number_value);
+    } else {
+        RowMapper::ReadColumn(stmt, index, key.text_value);
+    }
+    key.id = sqlite3_column_int(stmt, index + 1);
+}
+
+std::vector<Payment>
+DatabaseManager::getPaymentsPage(const PaymentPageQuery &query,
+                                 const PaymentPageKey *after, int limit) {
+    std::vector<Payment> payments;
+    if (!db)
+        return payments;
+
+    const PaymentFilter filter = payment_filter(query, trigramIndex);
+    std::string sql = "SELECT id, date, doc_number, type, amount, recipient, "
+                      "description, counterparty_id FROM Payments" +
+                      payment_page_where(query, filter, after != nullptr) +
+                      payment_page_order(query) + " LIMIT ?;";
+    sqlite3_stmt *stmt = prepareCached(sql);
+    if (!stmt) {
+        std::cerr << "Failed to prepare statement for getPaymentsPage: "
+                  << sqlite3_errmsg(db) << std::endl;
+        return payments;
+    }
+    int index = bind_payment_page(stmt, query, filter, after);
+    sqlite3_bind_int(stmt, index, limit);
+
+    if (limit > 0) {
+        payments.reserve(limit);
+    }
+    RowMapper::ReadAll(stmt, payment_columns, payments);
+    sqlite3_reset(stmt);
+    return payments;
+}
+
+int DatabaseManager::countPayments(const PaymentPageQuery &query) {
+    if (!db)
+        return 0;
+
+    const PaymentFilter filter = payment_filter(query, trigramIndex);
+    std::string sql = "SELECT COUNT(*) FROM Payments" +
+                      payment_page_where(query, filter, false) +
+                      ";";
+    sqlite3_stmt *stmt = prepareCached(sql);
+    if (!stmt) {
+        std::cerr << "Failed to prepare statement for countPayments: "
+                  << sqlite3_errmsg(db) << std::endl;
+        return 0;
+    }
+    bind_payment_page(stmt, query, filter, nullptr);
+
+    int count = 0;
+    if (sqlite3_step(stmt) == SQLITE_ROW) {
+        count = sqlite3_column_int(stmt, 0);
+    }
+    sqlite3_reset(stmt);
+    return count;
+}
+
+bool DatabaseManager::getPaymentPageKey(const PaymentPageQuery &query,
+                                        const PaymentPageKey *after,
+                                        int offset, PaymentPageKey &key) {
+    if (!db)
+        return false;
+
+    // Выбираются только ключевые столбцы, поэтому пропуск строк через OFFSET
+    // идёт по индексу без чтения самих платежей
+    const PaymentFilter filter = payment_filter(query, trigramIndex);
+    std::string sql = std::string("SELECT ") +
+                      payment_sort_expression(query.sort_column) +
+                      ", id FROM Payments" +
+                      payment_page_where(query, filter, after != nullptr) +
+                      payment_page_order(query) + " LIMIT 1 OFFSET ?;";
+    sqlite3_stmt *stmt = prepareCached(sql);
+    if (!stmt) {
+        std::cerr << "Failed to prepare statement for getPaymentPageKey: "
+                  << sqlite3_errmsg(db) << std::endl;
+        return false;
+    }
+    int index = bind_payment_page(stmt, query, filter, after);
+    sqlite3_bind_int(stmt, index, offset);
+
+    bool found = false;
+    if (sqlite3_step(stmt) == SQLITE_ROW) {
+        read_payment_page_key(stmt, 0, query.sort_column, key);
+        found = true;
+    }
+    sqlite3_reset(stmt);
+    return found;
+}
+
+bool DatabaseManager::getPaymentIds(const PaymentPageQuery &query,
+                                    std::vector<int> &ids) {
+    ids.clear();
+    if (!db)
+        return false;
+
+    const PaymentFilter filter = payment_filter(query, trigramIndex);
+    std::string sql = "SELECT id FROM Payments" +
+                      payment_page_where(query, filter, false) +
+                      payment_page_order(query) + ";";
+    sqlite3_stmt *stmt = prepareCached(sql);
+    if (!stmt) {
+        std::cerr << "Failed to prepare statement for getPaymentIds: "
+                  << sqlite3_errmsg(db) << std::endl;
+        return false;
+    }
+    bind_payment_page(stmt, query, filter, nullptr);
+
+    int rc;
+    while ((rc = sqlite3_step(stmt)) == SQLITE_ROW) {
+        ids.push_back(sqlite3_column_int(stmt, 0));
+    }
+    sqlite3_reset(stmt);
+    if (rc != SQLITE_DONE) {
+        std::cerr << "Failed to read payment ids: " << sqlite3_errmsg(db)
+                  << std::endl;
+        ids.clear();
+        return false;
+    }
+    return true;
+}
+
+// Число параметров в запросе getPaymentsByIds: один подготовленный запрос
+// на любое число id, недостающие параметры остаются NULL
+static const size_t PAYMENT_ID_CHUNK = 100;
+
+std::vector<Payment> DatabaseManager::getPaymentsByIds(const int *ids,
+                                                       size_t count) {
+    std::vector<Payment> payments;
+    if (!db || count == 0)
+        return payments;
+
+    std::string sql = "SELECT id, date, doc_number, type, amount, recipient, "
+                      "description, counterparty_id FROM Payments WHERE id IN (";
+    for (size_t i = 0; i < PAYMENT_ID_CHUNK; ++i) {
+        sql += i == 0 ? "?" : ", ?";
+    }
+    sql += ");";
+    sqlite3_stmt *stmt = prepareCached(sql);
+    if (!stmt) {
+        std::cerr << "Failed to prepare statement for getPaymentsByIds: "
+                  << sqlite3_errmsg(db) << std::endl;
+        return payments;
+    }
+
+    // IN возвращает строки в порядке id; порядок запроса восстанавливается
+    // по позиции каждого id
+    std::unordered_map<int, size_t> position;
+    position.reserve(count);
+    for (size_t i = 0; i < count; ++i) {
+        position.emplace(ids[i], i);
+    }
+    std::vector<Payment> slots(count);
+    std::vector<bool> found(count, false);
+    std::vector<Payment> chunk;
+    for (size_t start = 0; start < count; start += PAYMENT_ID_CHUNK) {
+        const size_t end = std::min(count, start + PAYMENT_ID_CHUNK);
+        sqlite3_clear_bindings(stmt);
+        for (size_t i = start; i < end; ++i) {
+            sqlite3_bind_int(stmt, static_cast<int>(i - start + 1), ids[i]);
+        }
+        chunk.clear();
+        const bool ok = RowMapper::ReadAll(stmt, payment_columns, chunk);
+        sqlite3_reset(stmt);
+        if (!ok) {
+            std::cerr << "Failed to read payments by id: "
+                      << sqlite3_errmsg(db) << std::endl;
+            return payments;
+        }
+        for (Payment &payment : chunk) {
+            const size_t slot = position[payment.id];
+            slots[slot] = std::move(payment);
+            found[slot] = true;
+        }
+    }
+
+    // Удалённые после чтения списка платежи просто пропускаются
+    payments.reserve(count);
+    for (size_t i = 0; i < count; ++i) {
+        if (found[i]) {
+            payments.push_back(std::move(slots[i]));
+        }
+    }
+    return payments;
+}
+
+bool DatabaseManager::hasFullTextSearch() const { return fullTextSearch; }
+
+std::vector<PaymentSearchResult>
+DatabaseManager::searchPayments(const std::string &query, int limit) {
+    std::vector<PaymentSearchResult> results;
+    if (!db)
+        return results;
+
+    std::string sql;
+    std::string pattern;
+    if (fullTextSearch) {
+        pattern = build_fts_query(query);
+        if (pattern.empty())
+            return results;
+        sql = "SELECT p.id, p.date, p.doc_number, p.type, p.amount, "
+              "p.recipient, p.description, p.counterparty_id, "
+              "snippet(PaymentsFts, 0, '[', ']', '...', 16), "
+              "PaymentsFts.rank "
+              "FROM PaymentsFts JOIN Payments p ON p.id = PaymentsFts.rowid "
+              "WHERE PaymentsFts MATCH ? ORDER BY PaymentsFts.rank LIMIT ?;";
+    } else {
+        pattern = query;
+        sql = "SELECT id, date, doc_number, type, amount, recipient, "
+              "description, counterparty_id, description, 0 "
+              "FROM Payments WHERE description LIKE '%' || ? || '%' "
+              "ORDER BY date DESC LIMIT ?;";
+    }
+
+    sqlite3_stmt *stmt = prepareCached(sql);
+    if (!stmt) {
+        std::cerr << "Failed to prepare statement for searchPayments: "
+                  << sqlite3_errmsg(db) << std::endl;
+        return results;
+    }
+    sqlite3_bind_text(stmt, 1, pattern.c_str(), -1, SQLITE_STATIC);
+    sqlite3_bind_int(stmt, 2, limit);
+
+    int rc;
+    while ((rc = sqlite3_step(stmt)) == SQLITE_ROW) {
+        PaymentSearchResult r;
+        RowMapper::ReadRow(stmt, r.payment, payment_columns);
+        RowMapper::ReadColumn(stmt, 8, r.snippet);
+        RowMapper::ReadColumn(stmt, 9, r.rank);
+        results.push_back(r);
+    }
+    if (rc != SQLITE_DONE) {
+        std::cerr << "Payment search failed: " << sqlite3_errmsg(db)
+                  << std::endl;
+    }
+
+    sqlite3_reset(stmt);
     return results;
 }
 
@@ -1078,105 +2093,85 @@ bool DatabaseManager::addPaymentDetail(PaymentDetail &detail) {
     std::string sql =
         "INSERT INTO PaymentDetails (payment_id, kosgu_id, contract_id, "
         "invoice_id, amount) VALUES (?, ?, ?, ?, ?);";
-    sqlite3_stmt *stmt = nullptr;
-    int rc = sqlite3_prepare_v2(db, sql.c_str(), -1, &stmt, nullptr);
-    if (rc != SQLITE_OK) {
+    sqlite3_stmt *stmt = prepareCached(sql);
+    if (!stmt) {
         std::cerr << "Failed to prepare statement for payment detail: "
                   << sqlite3_errmsg(db) << std::endl;
         return false;
     }
     sqlite3_bind_int(stmt, 1, detail.payment_id);
-    sqlite3_bind_int(stmt, 2, detail.kosgu_id);
-    sqlite3_bind_int(stmt, 3, detail.contract_id);
-    sqlite3_bind_int(stmt, 4, detail.invoice_id);
+    bind_optional_id(stmt, 2, detail.kosgu_id);
+    bind_optional_id(stmt, 3, detail.contract_id);
+    bind_optional_id(stmt, 4, detail.invoice_id);
     sqlite3_bind_double(stmt, 5, detail.amount);
 
-    rc = sqlite3_step(stmt);
+    int rc = sqlite3_step(stmt);
     if (rc != SQLITE_DONE) {
         std::cerr << "Failed to add payment detail: " << sqlite3_errmsg(db)
                   << std::endl;
-        sqlite3_finalize(stmt);
+        sqlite3_reset(stmt);
         return false;
     }
     detail.id = sqlite3_last_insert_rowid(db);
-    sqlite3_finalize(stmt);
+    sqlite3_reset(stmt);
     return true;
 }
 
-static int payment_detail_select_callback(void *data, int argc, char **argv,
-                                          char **azColName) {
-    auto *details = static_cast<std::vector<PaymentDetail> *>(data);
-    PaymentDetail pd;
-    for (int i = 0; i < argc; i++) {
-        std::string colName = azColName[i];
-        if (colName == "id")
-            pd.id = argv[i] ? std::stoi(argv[i]) : -1;
-        else if (colName == "payment_id")
-            pd.payment_id = argv[i] ? std::stoi(argv[i]) : -1;
-        else if (colName == "kosgu_id")
-            pd.kosgu_id = argv[i] ? std::stoi(argv[i]) : -1;
-        else if (colName == "contract_id")
-            pd.contract_id = argv[i] ? std::stoi(argv[i]) : -1;
-        else if (colName == "invoice_id")
-            pd.invoice_id = argv[i] ? std::stoi(argv[i]) : -1;
-        else if (colName == "amount")
-            pd.amount = argv[i] ? std::stod(argv[i]) : 0.0;
-    }
-    details->push_back(pd);
-    return 0;
-}
-
 std::vector<PaymentDetail> DatabaseManager::getPaymentDetails(int payment_id) {
     std::vector<PaymentDetail> details;
     if (!db)
         return details;
 
-    std::string sql = "SELECT * FROM PaymentDetails WHERE payment_id = ?;";
-    sqlite3_stmt *stmt = nullptr;
-    int rc = sqlite3_prepare_v2(db, sql.c_str(), -1, &stmt, nullptr);
-    if (rc != SQLITE_OK) {
+    std::string sql = "SELECT id, payment_id, kosgu_id, contract_id, "
+                      "invoice_id, amount FROM PaymentDetails "
+                      "WHERE payment_id = ?;";
+    sqlite3_stmt *stmt = prepareCached(sql);
+    if (!stmt) {
         std::cerr << "Failed to prepare statement for getting payment details: "
                   << sqlite3_errmsg(db) << std::endl;
         return details;
     }
     sqlite3_bind_int(stmt, 1, payment_id);
 
-    while (sqlite3_step(stmt) == SQLITE_ROW) {
-        PaymentDetail pd;
-        pd.id = sqlite3_column_int(stmt, 0);
-        pd.payment_id = sqlite3_column_int(stmt, 1);
-        pd.kosgu_id = sqlite3_column_int(stmt, 2);
-        pd.contract_id = sqlite3_column_int(stmt, 3);
-        pd.invoice_id = sqlite3_column_int(stmt, 4);
-        pd.amount = sqlite3_column_double(stmt, 5);
-        details.push_back(pd);
-    }
+    RowMapper::ReadAll(stmt, payment_detail_columns, details);
 
-    sqlite3_finalize(stmt);
+    sqlite3_reset(stmt);
     return details;
 }
 
+bool DatabaseManager::forEachPaymentDetail(
+    const std::function<void(const PaymentDetail &)> &visit) {
+    return scanRows("SELECT id, payment_id, kosgu_id, contract_id, "
+                    "invoice_id, amount FROM PaymentDetails;",
+                    payment_detail_columns, visit, "PaymentDetails");
+}
+
+bool DatabaseManager::getPaymentDetailById(int id, PaymentDetail &detail) {
+    return selectRowById("SELECT id, payment_id, kosgu_id, contract_id, "
+                         "invoice_id, amount FROM PaymentDetails WHERE id = ?;",
+                         id, payment_detail_columns, detail, "payment detail");
+}
+
 bool DatabaseManager::updatePaymentDetail(const PaymentDetail &detail) {
     if (!db)
         return false;
     std::string sql = "UPDATE PaymentDetails SET kosgu_id = ?, contract_id = "
                       "?, invoice_id = ?, amount = ? WHERE id = ?;";
-    sqlite3_stmt *stmt = nullptr;
-    int rc = sqlite3_prepare_v2(db, sql.c_str(), -1, &stmt, nullptr);
-    if (rc != SQLITE_OK) {
+    sqlite3_stmt *stmt = prepareCached(sql);
+    if (!stmt) {
         std::cerr << "Failed to prepare statement for updating payment detail: "
                   << sqlite3_errmsg(db) << std::endl;
         return false;
     }
 
-    sqlite3_bind_int(stmt, 1, detail.kosgu_id);
-    sqlite3_bind_int(stmt, 2, detail.contract_id);
-    sqlite3_bind_int(stmt, 3, detail.invoice_id);
+    bind_optional_id(stmt, 1, detail.kosgu_id);
+    bind_optional_id(stmt, 2, detail.contract_id);
+    bind_optional_id(stmt, 3, detail.invoice_id);
     sqlite3_bind_double(stmt, 4, detail.amount);
     sqlite3_bind_int(stmt, 5, detail.id);
 
-    rc = sqlite3_step(stmt);
-    sqlite3_finalize(stmt);
+    int rc = sqlite3_step(stmt);
+    sqlite3_reset(stmt);
 
     if (rc != SQLITE_DONE) {
         std::cerr << "Failed to update payment detail: " << sqlite3_errmsg(db)
@@ -1190,17 +2185,16 @@ bool DatabaseManager::deletePaymentDetail(int id) {
     if (!db)
         return false;
     std::string sql = "DELETE FROM PaymentDetails WHERE id = ?;";
-    sqlite3_stmt *stmt = nullptr;
-    int rc = sqlite3_prepare_v2(db, sql.c_str(), -1, &stmt, nullptr);
-    if (rc != SQLITE_OK) {
+    sqlite3_stmt *stmt = prepareCached(sql);
+    if (!stmt) {
         std::cerr << "Failed to prepare statement for deleting payment detail: "
                   << sqlite3_errmsg(db) << std::endl;
         return false;
     }
     sqlite3_bind_int(stmt, 1, id);
 
-    rc = sqlite3_step(stmt);
-    sqlite3_finalize(stmt);
+    int rc = sqlite3_step(stmt);
+    sqlite3_reset(stmt);
 
     if (rc != SQLITE_DONE) {
         std::cerr << "Failed to delete payment detail: " << sqlite3_errmsg(db)
@@ -1211,37 +2205,12 @@ bool DatabaseManager::deletePaymentDetail(int id) {
 }
 
 // Regex CRUD
-static int regex_select_callback(void *data, int argc, char **argv,
-                                 char **azColName) {
-    std::vector<Regex> *regex_list = static_cast<std::vector<Regex> *>(data);
-    Regex entry;
-    for (int i = 0; i < argc; i++) {
-        std::string colName = azColName[i];
-        if (colName == "id") {
-            entry.id = argv[i] ? std::stoi(argv[i]) : -1;
-        } else if (colName == "name") {
-            entry.name = argv[i] ? argv[i] : "";
-        } else if (colName == "pattern") {
-            entry.pattern = argv[i] ? argv[i] : "";
-        }
-    }
-    regex_list->push_back(entry);
-    return 0;
-}
-
 std::vector<Regex> DatabaseManager::getRegexes() {
     std::vector<Regex> entries;
     if (!db)
         return entries;
 
-    std::string sql = "SELECT id, name, pattern FROM Regexes;";
-    char *errmsg = nullptr;
-    int rc =
-        sqlite3_exec(db, sql.c_str(), regex_select_callback, &entries, &errmsg);
-    if (rc != SQLITE_OK) {
-        std::cerr << "Failed to select Regex entries: " << errmsg << std::endl;
-        sqlite3_free(errmsg);
-    }
+    selectRows("SELECT id, name, pattern FROM Regexes;", regex_columns, entries, "Regex entries");
     return entries;
 }
 
@@ -1249,9 +2218,8 @@ bool DatabaseManager::addRegex(Regex &regex) {
     if (!db)
         return false;
     std::string sql = "INSERT INTO Regexes (name, pattern) VALUES (?, ?);";
-    sqlite3_stmt *stmt = nullptr;
-    int rc = sqlite3_prepare_v2(db, sql.c_str(), -1, &stmt, nullptr);
-    if (rc != SQLITE_OK) {
+    sqlite3_stmt *stmt = prepareCached(sql);
+    if (!stmt) {
         std::cerr << "Failed to prepare statement: " << sqlite3_errmsg(db)
                   << std::endl;
         return false;
@@ -1259,13 +2227,13 @@ bool DatabaseManager::addRegex(Regex &regex) {
     sqlite3_bind_text(stmt, 1, regex.name.c_str(), -1, SQLITE_STATIC);
     sqlite3_bind_text(stmt, 2, regex.pattern.c_str(), -1, SQLITE_STATIC);
 
-    rc = sqlite3_step(stmt);
+    int rc = sqlite3_step(stmt);
     if (rc != SQLITE_DONE) {
-        sqlite3_finalize(stmt);
+        sqlite3_reset(stmt);
         return false;
     }
     regex.id = sqlite3_last_insert_rowid(db);
-    sqlite3_finalize(stmt);
+    sqlite3_reset(stmt);
     return true;
 }
 
@@ -1273,9 +2241,8 @@ bool DatabaseManager::updateRegex(const Regex &regex) {
     if (!db)
         return false;
     std::string sql = "UPDATE Regexes SET name = ?, pattern = ? WHERE id = ?;";
-    sqlite3_stmt *stmt = nullptr;
-    int rc = sqlite3_prepare_v2(db, sql.c_str(), -1, &stmt, nullptr);
-    if (rc != SQLITE_OK) {
+    sqlite3_stmt *stmt = prepareCached(sql);
+    if (!stmt) {
         std::cerr << "Failed to prepare statement: " << sqlite3_errmsg(db)
                   << std::endl;
         return false;
@@ -1284,8 +2251,8 @@ bool DatabaseManager::updateRegex(const Regex &regex) {
     sqlite3_bind_text(stmt, 2, regex.pattern.c_str(), -1, SQLITE_STATIC);
     sqlite3_bind_int(stmt, 3, regex.id);
 
-    rc = sqlite3_step(stmt);
-    sqlite3_finalize(stmt);
+    int rc = sqlite3_step(stmt);
+    sqlite3_reset(stmt);
 
     return rc == SQLITE_DONE;
 }
@@ -1294,17 +2261,101 @@ bool DatabaseManager::deleteRegex(int id) {
     if (!db)
         return false;
     std::string sql = "DELETE FROM Regexes WHERE id = ?;";
-    sqlite3_stmt *stmt = nullptr;
-    int rc = sqlite3_prepare_v2(db, sql.c_str(), -1, &stmt, nullptr);
-    if (rc != SQLITE_OK) {
+    sqlite3_stmt *stmt = prepareCached(sql);
+    if (!stmt) {
         std::cerr << "Failed to prepare statement: " << sqlite3_errmsg(db)
                   << std::endl;
         return false;
     }
     sqlite3_bind_int(stmt, 1, id);
 
-    rc = sqlite3_step(stmt);
-    sqlite3_finalize(stmt);
+    int rc = sqlite3_step(stmt);
+    sqlite3_reset(stmt);
+
+    return rc == SQLITE_DONE;
+}
+
+// Import checkpoints
+std::vector<ImportCheckpoint> DatabaseManager::getImportCheckpoints() {
+    std::vector<ImportCheckpoint> checkpoints;
+    if (!db)
+        return checkpoints;
+
+    selectRows("SELECT file_path, file_size, file_hash, byte_offset, "
+               "rows_committed, updated_at FROM ImportCheckpoints "
+               "ORDER BY updated_at DESC;",
+               checkpoint_columns, checkpoints, "import checkpoints");
+    return checkpoints;
+}
+
+bool DatabaseManager::getImportCheckpoint(const std::string &file_path,
+                                          ImportCheckpoint &checkpoint) {
+    if (!db)
+        return false;
+    std::string sql = "SELECT file_path, file_size, file_hash, byte_offset, "
+                      "rows_committed, updated_at FROM ImportCheckpoints "
+                      "WHERE file_path = ?;";
+    sqlite3_stmt *stmt = prepareCached(sql);
+    if (!stmt) {
+        std::cerr << "Failed to prepare statement for import checkpoint: "
+                  << sqlite3_errmsg(db) << std::endl;
+        return false;
+    }
+    sqlite3_bind_text(stmt, 1, file_path.c_str(), -1, SQLITE_STATIC);
+
+    bool found = false;
+    if (sqlite3_step(stmt) == SQLITE_ROW) {
+        RowMapper::ReadRow(stmt, checkpoint, checkpoint_columns);
+        found = true;
+    }
+    sqlite3_reset(stmt);
+    return found;
+}
+
+bool DatabaseManager::saveImportCheckpoint(const ImportCheckpoint &checkpoint) {
+    if (!db)
+        return false;
+    std::string sql =
+        "INSERT OR REPLACE INTO ImportCheckpoints (file_path, file_size, "
+        "file_hash, byte_offset, rows_committed, updated_at) "
+        "VALUES (?, ?, ?, ?, ?, datetime('now', 'localtime'));";
+    sqlite3_stmt *stmt = prepareCached(sql);
+    if (!stmt) {
+        std::cerr << "Failed to prepare statement: " << sqlite3_errmsg(db)
+                  << std::endl;
+        return false;
+    }
+    sqlite3_bind_text(stmt, 1, checkpoint.file_path.c_str(), -1,
+                      SQLITE_STATIC);
+    sqlite3_bind_int64(stmt, 2, checkpoint.file_size);
+    sqlite3_bind_int64(stmt, 3, checkpoint.file_hash);
+    sqlite3_bind_int64(stmt, 4, checkpoint.byte_offset);
+    sqlite3_bind_int64(stmt, 5, checkpoint.rows_committed);
+
+    int rc = sqlite3_step(stmt);
+    sqlite3_reset(stmt);
+    if (rc != SQLITE_DONE) {
+        std::cerr << "Failed to save import checkpoint: " << sqlite3_errmsg(db)
+                  << std::endl;
+        return false;
+    }
+    return true;
+}
+
+bool DatabaseManager::deleteImportCheckpoint(const std::string &file_path) {
+    if (!db)
+        return false;
+    std::string sql = "DELETE FROM ImportCheckpoints WHERE file_path = ?;";
+    sqlite3_stmt *stmt = prepareCached(sql);
+    if (!stmt) {
+        std::cerr << "Failed to prepare statement: " << sqlite3_errmsg(db)
+                  << std::endl;
+        return false;
+    }
+    sqlite3_bind_text(stmt, 1, file_path.c_str(), -1, SQLITE_STATIC);
+
+    int rc = sqlite3_step(stmt);
+    sqlite3_reset(stmt);
 
     return rc == SQLITE_DONE;
 }
@@ -1351,8 +2402,15 @@ bool DatabaseManager::executeSelect(
         result_pair(&columns, &rows);
 
     char *errmsg = nullptr;
+    const int changes_before = sqlite3_total_changes(db);
     int rc = sqlite3_exec(db, sql.c_str(), callback_collect_data, &result_pair,
                           &errmsg);
+    // DELETE без WHERE SQLite выполняет очисткой таблицы без вызова хука
+    // обновления, поэтому после любых изменений из окна SQL все таблицы
+    // перечитываются
+    if (sqlite3_total_changes(db) != changes_before) {
+        publishAllTablesChanged();
+    }
 
     if (rc != SQLITE_OK) {
         std::cerr << "SQL SELECT error: " << errmsg << std::endl;
@@ -1365,15 +2423,18 @@ bool DatabaseManager::executeSelect(
 
 // Settings
 Settings DatabaseManager::getSettings() {
-    Settings settings = {1, "", "", "", "", 20}; // Default settings
+    Settings settings = {1, "", "", "", "", 20, 1000,
+                         65536, 256, 5000, true}; // Default settings
     if (!db)
         return settings;
 
     std::string sql = "SELECT organization_name, period_start_date, "
-                      "period_end_date, note, import_preview_lines FROM Settings WHERE id = 1;";
-    sqlite3_stmt *stmt = nullptr;
-    int rc = sqlite3_prepare_v2(db, sql.c_str(), -1, &stmt, nullptr);
-    if (rc != SQLITE_OK) {
+                      "period_end_date, note, import_preview_lines, "
+                      "import_batch_size, db_cache_size_kb, db_mmap_size_mb, "
+                      "db_busy_timeout_ms, payment_snapshot FROM Settings "
+                      "WHERE id = 1;";
+    sqlite3_stmt *stmt = prepareCached(sql);
+    if (!stmt) {
         std::cerr << "Failed to prepare statement for getSettings: "
                   << sqlite3_errmsg(db) << std::endl;
         return settings;
@@ -1385,6 +2446,21 @@ Settings DatabaseManager::getSettings() {
         const unsigned char *end_date = sqlite3_column_text(stmt, 2);
         const unsigned char *note = sqlite3_column_text(stmt, 3);
         settings.import_preview_lines = sqlite3_column_int(stmt, 4);
+        if (sqlite3_column_type(stmt, 5) != SQLITE_NULL) {
+            settings.import_batch_size = sqlite3_column_int(stmt, 5);
+        }
+        if (sqlite3_column_type(stmt, 6) != SQLITE_NULL) {
+            settings.db_cache_size_kb = sqlite3_column_int(stmt, 6);
+        }
+        if (sqlite3_column_type(stmt, 7) != SQLITE_NULL) {
+            settings.db_mmap_size_mb = sqlite3_column_int(stmt, 7);
+        }
+        if (sqlite3_column_type(stmt, 8) != SQLITE_NULL) {
+            settings.db_busy_timeout_ms = sqlite3_column_int(stmt, 8);
+        }
+        if (sqlite3_column_type(stmt, 9) != SQLITE_NULL) {
+            settings.payment_snapshot = sqlite3_column_int(stmt, 9) != 0;
+        }
 
         settings.organization_name = org_name ? (const char *)org_name : "";
         settings.period_start_date = start_date ? (const char *)start_date : "";
@@ -1392,7 +2468,7 @@ Settings DatabaseManager::getSettings() {
         settings.note = note ? (const char *)note : "";
     }
 
-    sqlite3_finalize(stmt);
+    sqlite3_reset(stmt);
     return settings;
 }
 
@@ -1401,10 +2477,11 @@ bool DatabaseManager::updateSettings(const Settings &settings) {
         return false;
     std::string sql =
         "UPDATE Settings SET organization_name = ?, period_start_date = ?, "
-        "period_end_date = ?, note = ?, import_preview_lines = ? WHERE id = 1;";
-    sqlite3_stmt *stmt = nullptr;
-    int rc = sqlite3_prepare_v2(db, sql.c_str(), -1, &stmt, nullptr);
-    if (rc != SQLITE_OK) {
+        "period_end_date = ?, note = ?, import_preview_lines = ?, "
+        "import_batch_size = ?, db_cache_size_kb = ?, db_mmap_size_mb = ?, "
+        "db_busy_timeout_ms = ?, payment_snapshot = ? WHERE id = 1;";
+    sqlite3_stmt *stmt = prepareCached(sql);
+    if (!stmt) {
         std::cerr << "Failed to prepare statement for updateSettings: "
                   << sqlite3_errmsg(db) << std::endl;
         return false;
@@ -1418,14 +2495,21 @@ bool DatabaseManager::updateSettings(const Settings &settings) {
                       SQLITE_STATIC);
     sqlite3_bind_text(stmt, 4, settings.note.c_str(), -1, SQLITE_STATIC);
     sqlite3_bind_int(stmt, 5, settings.import_preview_lines);
+    sqlite3_bind_int(stmt, 6, settings.import_batch_size);
+    sqlite3_bind_int(stmt, 7, settings.db_cache_size_kb);
+    sqlite3_bind_int(stmt, 8, settings.db_mmap_size_mb);
+    sqlite3_bind_int(stmt, 9, settings.db_busy_timeout_ms);
+    sqlite3_bind_int(stmt, 10, settings.payment_snapshot ? 1 : 0);
 
-    rc = sqlite3_step(stmt);
-    sqlite3_finalize(stmt);
+    int rc = sqlite3_step(stmt);
+    sqlite3_reset(stmt);
 
     if (rc != SQLITE_DONE) {
         std::cerr << "Failed to update Settings: " << sqlite3_errmsg(db)
                   << std::endl;
         return false;
     }
+    applyConnectionSettings(settings);
+    appliedSettingsVersion = getTableVersion(DbTable::Settings);
     return true;
 }
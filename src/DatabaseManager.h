@@ -1,7 +1,13 @@
 #pragma once
 
+#include <array>
+#include <atomic>
+#include <functional>
 #include <string>
 #include <vector>
+#include <memory>
+#include <unordered_map>
+#include <unordered_set>
 #include <sqlite3.h>
 
 #include "Kosgu.h"
@@ -12,6 +18,8 @@
 #include "PaymentDetail.h"
 #include "Settings.h"
 #include "Regex.h"
+#include "ImportCheckpoint.h"
+#include "ChangeBus.h"
 
 class DatabaseManager {
 public:
@@ -19,15 +27,58 @@ public:
 ~DatabaseManager();
 
     bool open(const std::string& filepath);
+    // Opens another connection to a file that open() has already migrated:
+    // the same setup without schema migrations (writer and loader
+    // connections).
+    bool openSecondary(const std::string& filepath);
     void close();
     bool createDatabase(const std::string& filepath);
     bool is_open() const;
+    // True if the last failed statement broke a foreign key, e.g. deleting
+    // a dictionary entry that other rows still refer to.
+    bool isForeignKeyViolation() const;
+    // Path of the open database, empty when closed.
+    const std::string& getDatabasePath() const;
+
+    // Separate connection to the same file for background writers (import).
+    // Owned by this manager and closed together with it; must be used from
+    // one thread at a time.
+    DatabaseManager* getWriterConnection();
+
+    // Transactions
+    bool beginTransaction();
+    bool commitTransaction();
+    bool rollbackTransaction();
+    bool createSavepoint(const std::string& name);
+    bool releaseSavepoint(const std::string& name);
+    bool rollbackToSavepoint(const std::string& name);
+
+    // Grows whenever a transaction that changed 'table' commits through
+    // this manager or its writer connection, and when a database is opened
+    // or closed. Caches compare it to rebuild only after a change.
+    unsigned long long getTableVersion(DbTable table) const;
+    // Committed row changes of this manager and its writer connection;
+    // opening or closing a database publishes Reload for every table.
+    ChangeBus& getChangeBus();
+
+    // Prepared statement cache statistics
+    size_t getStatementCacheHits() const;
+    size_t getStatementCacheMisses() const;
+    // The same for the writer connection (import); zero until it is opened.
+    // Safe to read while an import is running.
+    size_t getWriterStatementCacheHits() const;
+    size_t getWriterStatementCacheMisses() const;
 
     // Settings
     Settings getSettings();
     bool updateSettings(const Settings& settings);
+    // Applies cache_size, mmap_size and busy_timeout to the open connection.
+    // updateSettings applies them here at once; the writer connection picks
+    // them up at its next beginTransaction().
+    void applyConnectionSettings(const Settings& settings);
 
     std::vector<Kosgu> getKosguEntries();
+    bool getKosguById(int id, Kosgu& entry);
     bool addKosguEntry(const Kosgu& entry);
     bool updateKosguEntry(const Kosgu& entry);
     bool deleteKosguEntry(int id);
@@ -37,6 +88,7 @@ public:
     int getCounterpartyIdByNameInn(const std::string& name, const std::string& inn);
     int getCounterpartyIdByName(const std::string& name);
     std::vector<Counterparty> getCounterparties();
+    bool getCounterpartyById(int id, Counterparty& counterparty);
     bool updateCounterparty(const Counterparty& counterparty);
     bool deleteCounterparty(int id);
     std::vector<ContractPaymentInfo> getPaymentInfoForCounterparty(int counterparty_id);
@@ -44,6 +96,7 @@ public:
     bool addContract(Contract& contract); // Pass by reference to get the id back
     int getContractIdByNumberDate(const std::string& number, const std::string& date);
     std::vector<Contract> getContracts();
+    bool getContractById(int id, Contract& contract);
     bool updateContract(const Contract& contract);
     bool deleteContract(int id);
     std::vector<ContractPaymentInfo> getPaymentInfoForContract(int contract_id);
@@ -51,25 +104,59 @@ public:
     bool addInvoice(Invoice& invoice); // Pass by reference to get the id back
     int getInvoiceIdByNumberDate(const std::string& number, const std::string& date);
     std::vector<Invoice> getInvoices();
+    bool getInvoiceById(int id, Invoice& invoice);
     bool updateInvoice(const Invoice& invoice);
     bool deleteInvoice(int id);
     std::vector<ContractPaymentInfo> getPaymentInfoForInvoice(int invoice_id);
 
 
     std::vector<Payment> getPayments();
+    bool getPaymentById(int id, Payment& payment);
     bool addPayment(Payment& payment);
     bool updatePayment(const Payment& payment);
     bool deletePayment(int id);
     std::vector<ContractPaymentInfo> getPaymentInfoForKosgu(int kosgu_id);
+    // Fingerprints of all imported payments (see PaymentFingerprint)
+    bool getPaymentFingerprints(std::unordered_set<long long>& fingerprints);
+    // Calls 'visit' for every payment / payment detail without collecting
+    // them into a vector (see PaymentColumns). Returns false on error.
+    bool forEachPayment(const std::function<void(const Payment&)>& visit);
+    bool forEachPaymentDetail(const std::function<void(const PaymentDetail&)>& visit);
+
+    // Keyset pagination over Payments ordered by (sort column, id).
+    // 'after' is the key of the last row of the previous page, or nullptr
+    // for the first page; limit < 0 returns all remaining rows.
+    std::vector<Payment> getPaymentsPage(const PaymentPageQuery& query, const PaymentPageKey* after, int limit);
+    int countPayments(const PaymentPageQuery& query);
+    // Key of the row 'offset' rows past 'after' (0 = the next row). Used to
+    // jump to a page without loading the rows before it.
+    bool getPaymentPageKey(const PaymentPageQuery& query, const PaymentPageKey* after, int offset, PaymentPageKey& key);
+    // Ids of all rows of 'query' in its order. Cheaper than keyset pages
+    // for a filter: the filter is evaluated once, not for every page.
+    bool getPaymentIds(const PaymentPageQuery& query, std::vector<int>& ids);
+    // Payments with the given ids in the same order; missing ids are skipped.
+    std::vector<Payment> getPaymentsByIds(const int* ids, size_t count);
+
+    // Full-text search over Payments.description. Uses the FTS5 index when
+    // the SQLite build supports it, otherwise falls back to LIKE.
+    bool hasFullTextSearch() const;
+    std::vector<PaymentSearchResult> searchPayments(const std::string& query, int limit);
 
     bool addPaymentDetail(PaymentDetail& detail);
     std::vector<PaymentDetail> getPaymentDetails(int payment_id);
+    bool getPaymentDetailById(int id, PaymentDetail& detail);
     bool updatePaymentDetail(const PaymentDetail& detail);
     bool deletePaymentDetail(int id);
 
     // Generic SQL query execution for SELECT statements
     bool executeSelect(const std::string& sql, std::vector<std::string>& columns, std::vector<std::vector<std::string>>& rows);
 
+    // Checkpoints of interrupted imports, keyed by file path
+    std::vector<ImportCheckpoint> getImportCheckpoints();
+    bool getImportCheckpoint(const std::string& file_path, ImportCheckpoint& checkpoint);
+    bool saveImportCheckpoint(const ImportCheckpoint& checkpoint);
+    bool deleteImportCheckpoint(const std::string& file_path);
+
     // Regex
     std::vector<Regex> getRegexes();
     bool addRegex(Regex& regex);
@@ -77,7 +164,63 @@ public:
     bool deleteRegex(int id);
 
 private:
+    bool openConnection(const std::string& filepath, bool run_migrations);
     bool execute(const std::string& sql);
+
+    // Schema migrations (PRAGMA user_version)
+    bool migrate();
+    bool migrateToV1();
+    bool migrateToV2();
+    bool migrateToV3();
+    bool migrateToV4();
+    bool migrateToV5();
+    bool migrateToV6();
+    bool migrateToV7();
+    bool migrateToV8();
+    bool migrateToV9();
+    int getUserVersion();
+    bool columnExists(const std::string& table, const std::string& column);
+    bool tableExists(const std::string& table);
+
+    sqlite3_stmt* prepareCached(const std::string& sql);
+    // Runs a parameterless SELECT and maps every row through RowMapper
+    template <typename Struct, typename Columns>
+    bool selectRows(const std::string& sql, const Columns& columns, std::vector<Struct>& rows, const char* what);
+    // Same for a SELECT with one "id = ?" parameter; false if no row
+    template <typename Struct, typename Columns>
+    bool selectRowById(const std::string& sql, int id, const Columns& columns, Struct& row, const char* what);
+    template <typename Struct, typename Columns>
+    bool scanRows(const std::string& sql, const Columns& columns, const std::function<void(const Struct&)>& visit, const char* what);
+    void clearStatementCache();
+    // Re-reads Settings if the table changed since the last apply
+    void refreshConnectionSettings();
+
+    // Хуки SQLite: изменения строк копятся в pendingChanges и
+    // публикуются после фиксации транзакции
+    void installChangeHooks();
+    void publishPendingChanges();
+    void publishAllTablesChanged();
+    static void onRowChanged(void* self, int op, const char* database, const char* table, sqlite3_int64 rowid);
+    static int onCommit(void* self);
+    static void onRollback(void* self);
+    static int onWalCommit(void* self, sqlite3* db, const char* database, int pages);
+
+    using TableVersions = std::array<std::atomic<unsigned long long>, static_cast<size_t>(DbTable::Count)>;
     
     sqlite3* db;
+    std::string databasePath;
+    bool fullTextSearch = false;
+    bool trigramIndex = false; // PaymentsTrigram для фильтра по подстроке
+    std::unique_ptr<DatabaseManager> writerConnection;
+    // Общие с соединением для записи: изменения из импорта видны окнам
+    std::shared_ptr<TableVersions> tableVersions;
+    std::shared_ptr<ChangeBus> changeBus;
+    DbChangeSet pendingChanges; // Изменения текущей транзакции
+    bool walMode = false;
+    // Версия Settings, с которой применены настройки соединения
+    unsigned long long appliedSettingsVersion = 0;
+    std::unordered_map<std::string, sqlite3_stmt*> statementCache;
+    // Атомарные: счётчики соединения для записи читает окно настроек
+    std::atomic<size_t> statementCacheHits{0};
+    std::atomic<size_t> statementCacheMisses{0};
 };
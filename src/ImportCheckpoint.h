@@ -0,0 +1,15 @@
+#pragma once
+
+#include <string>
+
+// Место, до которого импорт файла зафиксирован в базе. Обновляется в той же
+// транзакции, что и очередная пачка строк, и удаляется после завершения
+// импорта, поэтому запись есть только у прерванных импортов.
+struct ImportCheckpoint {
+    std::string file_path;
+    long long file_size = 0;
+    long long file_hash = 0;      // Размер и первый/последний мегабайт файла
+    long long byte_offset = 0;    // Начало первой незафиксированной строки
+    long long rows_committed = 0; // Строк данных до byte_offset
+    std::string updated_at;
+};
@@ -0,0 +1,94 @@
+#include "ImportJob.h"
+#include <chrono>
+#include <iostream>
+
+namespace {
+
+long long now_ns() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+               std::chrono::steady_clock::now().time_since_epoch())
+        .count();
+}
+
+// Меньше этой доли файла оценка оставшегося времени слишком неустойчива
+const float MIN_ETA_FRACTION = 0.01f;
+
+} // namespace
+
+ImportJob::ImportJob() : progress(std::make_unique<ImportProgress>()) {}
+
+ImportJob::~ImportJob() {
+    Cancel();
+    Wait();
+}
+
+bool ImportJob::Start(const std::string &job_title,
+                      std::function<bool(ImportProgress &)> work) {
+    if (IsRunning()) {
+        std::cerr << "Import job is already running: " << title << std::endl;
+        return false;
+    }
+    // Предыдущий поток уже закончил работу, но ещё не присоединён
+    Wait();
+
+    title = job_title;
+    progress = std::make_unique<ImportProgress>();
+    startedNs = now_ns();
+    finishedNs = 0;
+    state = State::Running;
+
+    ImportProgress *job_progress = progress.get();
+    thread = std::thread([this, job_progress, work = std::move(work)]() {
+        bool ok = false;
+        try {
+            ok = work(*job_progress);
+        } catch (const std::exception &e) {
+            std::cerr << "Import job failed: " << e.what() << std::endl;
+            job_progress->message = std::string("Ошибка: ") + e.what();
+        }
+        finishedNs = now_ns();
+        // Итоговое сообщение записано до смены состояния: после неё
+        // интерфейс может его читать
+        state = ok ? State::Succeeded
+                   : job_progress->cancel_requested ? State::Cancelled
+                                                    : State::Failed;
+    });
+    return true;
+}
+
+void ImportJob::Cancel() {
+    if (IsRunning()) {
+        progress->cancel_requested = true;
+    }
+}
+
+void ImportJob::Wait() {
+    if (thread.joinable()) {
+        thread.join();
+    }
+}
+
+double ImportJob::ElapsedSeconds() const {
+    if (startedNs == 0) {
+        return 0.0;
+    }
+    const long long finished = finishedNs;
+    const long long end = finished != 0 ? finished : now_ns();
+    return (end - startedNs) / 1e9;
+}
+
+double ImportJob::RowsPerSecond() const {
+    const double seconds = ElapsedSeconds();
+    return seconds > 0.0 ? progress->rows_written / seconds : 0.0;
+}
+
+double ImportJob::EtaSeconds() const {
+    if (!IsRunning()) {
+        return 0.0;
+    }
+    const float fraction = progress->Fraction();
+    if (fraction < MIN_ETA_FRACTION) {
+        return -1.0;
+    }
+    return ElapsedSeconds() * (1.0 - fraction) / fraction;
+}
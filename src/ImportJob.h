@@ -0,0 +1,54 @@
+#pragma once
+
+#include <atomic>
+#include <functional>
+#include <memory>
+#include <string>
+#include <thread>
+#include "ImportManager.h"
+
+// Фоновое задание импорта или пробного прогона. Владеет потоком и ходом
+// выполнения; Cancel() только выставляет флаг, который импорт проверяет на
+// каждой строке, поэтому интерфейс не ждёт остановки.
+class ImportJob {
+public:
+    enum class State { Idle, Running, Succeeded, Failed, Cancelled };
+
+    ImportJob();
+    // Cancels a running job and waits for its thread.
+    ~ImportJob();
+    ImportJob(const ImportJob&) = delete;
+    ImportJob& operator=(const ImportJob&) = delete;
+
+    // Runs 'work' on a new thread with fresh progress counters. Returns false
+    // if a job is already running.
+    bool Start(const std::string& title,
+               std::function<bool(ImportProgress&)> work);
+    // Asks the running job to stop at the next row and returns immediately.
+    void Cancel();
+    // Waits for the job thread to finish.
+    void Wait();
+
+    State GetState() const { return state; }
+    bool IsRunning() const { return state == State::Running; }
+    bool IsCancelRequested() const { return progress->cancel_requested; }
+    const std::string& GetTitle() const { return title; }
+    // ImportProgress::message may be read only once the job is not running.
+    const ImportProgress& Progress() const { return *progress; }
+
+    double ElapsedSeconds() const;
+    // Rows that passed the last stage (write or check) per second.
+    double RowsPerSecond() const;
+    // Seconds left, extrapolated from the share of the file processed so
+    // far; negative while too little of the file is done to tell.
+    double EtaSeconds() const;
+
+private:
+    std::thread thread;
+    std::unique_ptr<ImportProgress> progress;
+    std::atomic<State> state{State::Idle};
+    std::string title;
+    // Время steady_clock в наносекундах; finishedNs пишет поток задания
+    long long startedNs = 0;
+    std::atomic<long long> finishedNs{0};
+};
@@ -4,28 +4,112 @@
 #include <vector>
 #include <map>
 #include <atomic>
-#include <mutex>
 #include "DatabaseManager.h"
 
 // Represents the mapping from a target field name (e.g., "Дата") 
 // to the index of the column in the source file.
 using ColumnMapping = std::map<std::string, int>;
 
+// Ход импорта или пробного прогона. Поток импорта только увеличивает
+// атомарные счётчики стадий, без блокировок и строк в цикле; интерфейс
+// читает их и сам форматирует при отрисовке кадра.
+struct ImportProgress {
+    std::atomic<size_t> bytes_total{0};
+    std::atomic<size_t> bytes_read{0};  // Прочитано потоком чтения
+    std::atomic<size_t> bytes_done{0};  // Дошло до записи (или проверки)
+    std::atomic<size_t> rows_read{0};
+    std::atomic<size_t> rows_parsed{0};
+    std::atomic<size_t> rows_written{0}; // Прошли запись (или проверку)
+    std::atomic<size_t> rows_failed{0};  // Ошибки разбора и отклонённые
+    // Время, которое каждая стадия была занята работой
+    std::atomic<long long> read_busy_ns{0};
+    std::atomic<long long> parse_busy_ns{0};
+    std::atomic<long long> write_busy_ns{0};
+    std::atomic<size_t> parse_threads{1};
+    std::atomic<bool> cancel_requested{false};
+
+    // Итог или ошибка. Записывается один раз, когда импорт заканчивается;
+    // другим потокам читать только после его завершения.
+    std::string message;
+
+    // Доля файла, прошедшая запись, 0..1
+    float Fraction() const;
+    // Rows per second of busy time for each stage, e.g.
+    // "чтение 1200000, разбор 350000 (4 потоков), запись 9600 строк/с".
+    std::string StageSummary(const char* last_stage) const;
+};
+
+// Строка файла, на которую стоит обратить внимание перед импортом
+struct ImportIssue {
+    size_t line = 0; // Номер строки данных, начиная с 1 (без заголовка)
+    std::string description;
+};
+
+// Итоги пробного прогона: что произойдёт с базой, если импортировать файл с
+// теми же сопоставлением столбцов и выражениями. Списки замечаний содержат
+// только первые строки каждого вида, счётчики - все.
+struct ImportDryRunStats {
+    std::string filepath;
+    bool completed = false;
+
+    size_t rows_total = 0;
+    size_t rows_to_import = 0;
+    size_t rows_skipped = 0;      // Пустые строки и строки без даты и суммы
+    size_t rows_parse_errors = 0;
+    size_t rows_already_imported = 0; // Совпали по отпечатку, пропускаются
+    size_t unparsed_amounts = 0;  // Будут записаны с суммой 0
+    size_t rows_without_contract = 0;
+    size_t rows_without_invoice = 0;
+    size_t unmatched_descriptions = 0; // Ни договора, ни накладной
+    size_t rows_with_kosgu_details = 0;
+    size_t detail_sum_mismatches = 0;  // "в т.ч." не сходится с суммой
+    size_t details_to_create = 0;
+
+    size_t new_counterparties = 0;
+    size_t existing_counterparties = 0;
+    size_t new_contracts = 0;
+    size_t existing_contracts = 0;
+    size_t new_invoices = 0;
+    size_t existing_invoices = 0;
+    size_t new_kosgu = 0;
+    size_t existing_kosgu = 0;
+
+    std::vector<ImportIssue> unparsed_amount_rows;
+    std::vector<ImportIssue> unmatched_rows;
+    std::vector<ImportIssue> detail_mismatch_rows;
+};
+
 class ImportManager {
 public:
     ImportManager();
 
     // Imports payments from a TSV file using a user-defined column mapping.
+    // With 'resume' set, rows before the file's checkpoint (see
+    // ImportCheckpoint) are only scanned, not extracted or written again.
+    // Stops at the next row once progress.cancel_requested is set: the
+    // uncommitted batch is rolled back, committed batches and their
+    // checkpoint are kept, and false is returned.
     bool ImportPaymentsFromTsv(
         const std::string& filepath, 
         DatabaseManager* dbManager, 
         const ColumnMapping& mapping,
-        std::atomic<float>& progress,
-        std::string& message,
-        std::mutex& message_mutex,
+        ImportProgress& progress,
+        const std::string& contract_regex,
+        const std::string& invoice_regex,
+        bool resume = false
+    );
+
+    // Runs the same parse and extraction pipeline as ImportPaymentsFromTsv
+    // without writing anything and fills 'stats'. Cancellation leaves
+    // 'stats' incomplete and returns false.
+    bool DryRunPaymentsFromTsv(
+        const std::string& filepath,
+        DatabaseManager* dbManager,
+        const ColumnMapping& mapping,
+        ImportProgress& progress,
         const std::string& contract_regex,
-        const std::string& kosgu_regex,
-        const std::string& invoice_regex
+        const std::string& invoice_regex,
+        ImportDryRunStats& stats
     );
 
 };
@@ -0,0 +1,160 @@
+#include "ImportResolver.h"
+
+ImportResolver::ImportResolver(DatabaseManager *dbManager)
+    : dbManager(dbManager) {}
+
+std::string ImportResolver::MakeKey(const std::string &number,
+                                    const std::string &date) {
+    std::string key;
+    key.reserve(number.size() + date.size() + 1);
+    key += number;
+    key += '\x1f'; // Unit separator: не встречается в номерах и датах
+    key += date;
+    return key;
+}
+
+void ImportResolver::Preload() {
+    counterpartiesByName.clear();
+    contractsByNumberDate.clear();
+    invoicesByNumberDate.clear();
+    kosguByCode.clear();
+    createdInRow.clear();
+    usage = Usage{};
+    usedCounterparties.clear();
+    usedContracts.clear();
+    usedInvoices.clear();
+    usedKosgu.clear();
+    if (!dbManager)
+        return;
+
+    // emplace оставляет первую запись при дублях - так же, как первая строка
+    // выборки в getCounterpartyIdByName / getContractIdByNumberDate.
+    for (const auto &cp : dbManager->getCounterparties()) {
+        // Импорт ищет контрагентов только по имени с пустым ИНН
+        if (cp.inn.empty()) {
+            counterpartiesByName.emplace(cp.name, cp.id);
+        }
+    }
+    for (const auto &c : dbManager->getContracts()) {
+        contractsByNumberDate.emplace(MakeKey(c.number, c.date), c.id);
+    }
+    for (const auto &inv : dbManager->getInvoices()) {
+        invoicesByNumberDate.emplace(MakeKey(inv.number, inv.date), inv.id);
+    }
+    for (const auto &k : dbManager->getKosguEntries()) {
+        kosguByCode.emplace(k.code, k.id);
+    }
+}
+
+void ImportResolver::Remember(Dictionary &dictionary, const std::string &key,
+                              int id) {
+    dictionary.emplace(key, id);
+    createdInRow.emplace_back(&dictionary, key);
+}
+
+int ImportResolver::Find(const Dictionary &dictionary, const std::string &key,
+                         std::unordered_set<int> &used,
+                         EntityUsage &entity_usage) {
+    auto it = dictionary.find(key);
+    if (it == dictionary.end()) {
+        return -1;
+    }
+    // Заглушки пробного прогона имеют id меньше -1 и не считаются
+    if (dryRun && it->second >= 0 && used.insert(it->second).second) {
+        entity_usage.existing++;
+    }
+    return it->second;
+}
+
+int ImportResolver::CreatePlaceholder(Dictionary &dictionary,
+                                      const std::string &key,
+                                      EntityUsage &entity_usage) {
+    int id = nextPlaceholderId--;
+    dictionary.emplace(key, id);
+    entity_usage.created++;
+    return id;
+}
+
+void ImportResolver::BeginRow() { createdInRow.clear(); }
+
+void ImportResolver::DiscardRow() {
+    for (const auto &entry : createdInRow) {
+        entry.first->erase(entry.second);
+    }
+    createdInRow.clear();
+}
+
+int ImportResolver::ResolveCounterparty(const std::string &name) {
+    int id = Find(counterpartiesByName, name, usedCounterparties,
+                  usage.counterparties);
+    if (id != -1) {
+        return id;
+    }
+    if (dryRun) {
+        return CreatePlaceholder(counterpartiesByName, name,
+                                 usage.counterparties);
+    }
+    Counterparty counterparty{-1, name, ""};
+    if (!dbManager->addCounterparty(counterparty)) {
+        return -1;
+    }
+    Remember(counterpartiesByName, name, counterparty.id);
+    return counterparty.id;
+}
+
+int ImportResolver::ResolveContract(const std::string &number,
+                                    const std::string &date,
+                                    int counterparty_id) {
+    std::string key = MakeKey(number, date);
+    int id = Find(contractsByNumberDate, key, usedContracts, usage.contracts);
+    if (id != -1) {
+        return id;
+    }
+    if (dryRun) {
+        return CreatePlaceholder(contractsByNumberDate, key, usage.contracts);
+    }
+    Contract contract{-1, number, date, counterparty_id};
+    if (!dbManager->addContract(contract)) {
+        return -1;
+    }
+    Remember(contractsByNumberDate, key, contract.id);
+    return contract.id;
+}
+
+int ImportResolver::ResolveInvoice(const std::string &number,
+                                   const std::string &date, int contract_id) {
+    std::string key = MakeKey(number, date);
+    int id = Find(invoicesByNumberDate, key, usedInvoices, usage.invoices);
+    if (id != -1) {
+        return id;
+    }
+    if (dryRun) {
+        return CreatePlaceholder(invoicesByNumberDate, key, usage.invoices);
+    }
+    Invoice invoice{-1, number, date, contract_id};
+    if (!dbManager->addInvoice(invoice)) {
+        return -1;
+    }
+    Remember(invoicesByNumberDate, key, invoice.id);
+    return invoice.id;
+}
+
+int ImportResolver::ResolveKosgu(const std::string &code) {
+    int id = Find(kosguByCode, code, usedKosgu, usage.kosgu);
+    if (id != -1) {
+        return id;
+    }
+    if (dryRun) {
+        return CreatePlaceholder(kosguByCode, code, usage.kosgu);
+    }
+    Kosgu kosgu{-1, code, "КОСГУ " + code};
+    if (!dbManager->addKosguEntry(kosgu)) {
+        return -1;
+    }
+    // addKosguEntry не возвращает id новой записи
+    id = dbManager->getKosguIdByCode(code);
+    if (id != -1) {
+        Remember(kosguByCode, code, id);
+    }
+    return id;
+}
@@ -0,0 +1,79 @@
+#pragma once
+
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include <utility>
+#include <vector>
+#include "DatabaseManager.h"
+
+// Справочники контрагентов, договоров, накладных и КОСГУ, загруженные в память
+// на время одного импорта. Поиск идёт по хеш-таблицам, в SQLite уходят только
+// вставки новых записей.
+class ImportResolver {
+public:
+    explicit ImportResolver(DatabaseManager* dbManager);
+
+    // Loads all dictionaries from the database.
+    void Preload();
+
+    // Find-or-create helpers. Return -1 if the entity could not be created.
+    int ResolveCounterparty(const std::string& name);
+    int ResolveContract(const std::string& number, const std::string& date,
+                        int counterparty_id);
+    int ResolveInvoice(const std::string& number, const std::string& date,
+                       int contract_id);
+    int ResolveKosgu(const std::string& code);
+
+    // Row scope: entities created after BeginRow() are forgotten by
+    // DiscardRow(), matching a ROLLBACK TO the row's savepoint.
+    void BeginRow();
+    void DiscardRow();
+
+    // Сколько записей справочника импорт создал бы и сколько уже
+    // существующих использовал бы; каждая запись считается один раз.
+    struct EntityUsage {
+        size_t created = 0;
+        size_t existing = 0;
+    };
+    struct Usage {
+        EntityUsage counterparties;
+        EntityUsage contracts;
+        EntityUsage invoices;
+        EntityUsage kosgu;
+    };
+
+    // Dry run: nothing is written, unknown entities get placeholder ids
+    // (below -1) and usage is counted. Call before Preload().
+    void SetDryRun(bool enabled) { dryRun = enabled; }
+    const Usage& GetUsage() const { return usage; }
+
+private:
+    using Dictionary = std::unordered_map<std::string, int>;
+
+    // Looks up 'key'; in dry-run mode also counts the first use of an
+    // existing entity. Returns -1 if the key is unknown.
+    int Find(const Dictionary& dictionary, const std::string& key,
+             std::unordered_set<int>& used, EntityUsage& entity_usage);
+    int CreatePlaceholder(Dictionary& dictionary, const std::string& key,
+                          EntityUsage& entity_usage);
+
+    static std::string MakeKey(const std::string& number,
+                               const std::string& date);
+    void Remember(Dictionary& dictionary, const std::string& key, int id);
+
+    DatabaseManager* dbManager;
+    Dictionary counterpartiesByName;
+    Dictionary contractsByNumberDate;
+    Dictionary invoicesByNumberDate;
+    Dictionary kosguByCode;
+    std::vector<std::pair<Dictionary*, std::string>> createdInRow;
+
+    bool dryRun = false;
+    int nextPlaceholderId = -2;
+    Usage usage;
+    std::unordered_set<int> usedCounterparties;
+    std::unordered_set<int> usedContracts;
+    std::unordered_set<int> usedInvoices;
+    std::unordered_set<int> usedKosgu;
+};
@@ -0,0 +1,180 @@
+#include "LabelIndex.h"
+#include "Utf8.h"
+#include <algorithm>
+#include <atomic>
+#include <unordered_map>
+
+namespace {
+
+// Короче этого (в символах) запрос ищется по началу подписи
+const size_t TRIGRAM_LENGTH = 3;
+
+// Поколения всех индексов; справочники строятся и в потоке загрузки
+std::atomic<unsigned> last_generation{0};
+
+// Символы строки UTF-8; байт некорректной последовательности считается
+// отдельным символом
+void code_points(const std::string &text, std::vector<uint32_t> &points) {
+    points.clear();
+    const size_t size = text.size();
+    size_t i = 0;
+    while (i < size) {
+        const unsigned char c = static_cast<unsigned char>(text[i]);
+        size_t length = c < 0x80 ? 1 : (c >> 5) == 0x6 ? 2 : (c >> 4) == 0xE ? 3
+                                       : (c >> 3) == 0x1E ? 4 : 1;
+        if (i + length > size) {
+            length = 1;
+        }
+        uint32_t point = length == 1 ? c : c & (0x7F >> length);
+        for (size_t k = 1; k < length; ++k) {
+            point = (point << 6) | (static_cast<unsigned char>(text[i + k]) &
+                                    0x3F);
+        }
+        points.push_back(point);
+        i += length;
+    }
+}
+
+// Триграммы строки без повторов, по возрастанию
+void trigrams(const std::vector<uint32_t> &points,
+              std::vector<uint64_t> &keys) {
+    keys.clear();
+    for (size_t i = 0; i + TRIGRAM_LENGTH <= points.size(); ++i) {
+        keys.push_back((static_cast<uint64_t>(points[i]) << 42) |
+                       (static_cast<uint64_t>(points[i + 1]) << 21) |
+                       points[i + 2]);
+    }
+    std::sort(keys.begin(), keys.end());
+    keys.erase(std::unique(keys.begin(), keys.end()), keys.end());
+}
+
+} // namespace
+
+void LabelIndex::Clear() {
+    generation = ++last_generation;
+    labels.clear();
+    folded.clear();
+    sortedPositions.clear();
+    trigramKeys.clear();
+    postingStarts.clear();
+    postings.clear();
+}
+
+void LabelIndex::Build(std::vector<std::string> source) {
+    Clear();
+    labels = std::move(source);
+    folded.reserve(labels.size());
+    for (const auto &label : labels) {
+        folded.push_back(Utf8::FoldCase(label));
+    }
+
+    sortedPositions.resize(labels.size());
+    for (size_t i = 0; i < labels.size(); ++i) {
+        sortedPositions[i] = static_cast<int>(i);
+    }
+    std::sort(sortedPositions.begin(), sortedPositions.end(),
+              [this](int a, int b) { return folded[a] < folded[b]; });
+
+    // Два прохода: сначала длины списков, затем сами списки. Подписи
+    // обходятся по возрастанию позиции, поэтому списки получаются
+    // отсортированными без сортировки пар (триграмма, позиция).
+    std::vector<std::vector<uint64_t>> label_trigrams(labels.size());
+    std::unordered_map<uint64_t, uint32_t> counts;
+    std::vector<uint32_t> points;
+    for (size_t i = 0; i < labels.size(); ++i) {
+        code_points(folded[i], points);
+        trigrams(points, label_trigrams[i]);
+        for (uint64_t key : label_trigrams[i]) {
+            counts[key]++;
+        }
+    }
+
+    trigramKeys.reserve(counts.size());
+    for (const auto &entry : counts) {
+        trigramKeys.push_back(entry.first);
+    }
+    std::sort(trigramKeys.begin(), trigramKeys.end());
+    postingStarts.resize(trigramKeys.size() + 1);
+    uint32_t total = 0;
+    for (size_t k = 0; k < trigramKeys.size(); ++k) {
+        postingStarts[k] = total;
+        total += counts[trigramKeys[k]];
+    }
+    postingStarts[trigramKeys.size()] = total;
+
+    postings.resize(total);
+    std::vector<uint32_t> fill(postingStarts.begin(), postingStarts.end() - 1);
+    for (size_t i = 0; i < labels.size(); ++i) {
+        for (uint64_t key : label_trigrams[i]) {
+            const size_t k =
+                std::lower_bound(trigramKeys.begin(), trigramKeys.end(), key) -
+                trigramKeys.begin();
+            postings[fill[k]++] = static_cast<int>(i);
+        }
+    }
+}
+
+void LabelIndex::Find(const std::string &query,
+                      std::vector<int> &matches) const {
+    matches.clear();
+    const std::string folded_query = Utf8::FoldCase(query);
+    if (folded_query.empty()) {
+        matches.resize(labels.size());
+        for (size_t i = 0; i < labels.size(); ++i) {
+            matches[i] = static_cast<int>(i);
+        }
+        return;
+    }
+
+    std::vector<uint32_t> points;
+    code_points(folded_query, points);
+    if (points.size() < TRIGRAM_LENGTH) {
+        FindPrefix(folded_query, matches);
+    } else {
+        std::vector<uint64_t> keys;
+        trigrams(points, keys);
+        FindSubstring(folded_query, keys, matches);
+    }
+}
+
+void LabelIndex::FindPrefix(const std::string &folded_query,
+                            std::vector<int> &matches) const {
+    auto first = std::lower_bound(
+        sortedPositions.begin(), sortedPositions.end(), folded_query,
+        [this](int position, const std::string &value) {
+            return folded[position] < value;
+        });
+    for (auto it = first; it != sortedPositions.end(); ++it) {
+        if (folded[*it].compare(0, folded_query.size(), folded_query) != 0) {
+            break;
+        }
+        matches.push_back(*it);
+    }
+    std::sort(matches.begin(), matches.end());
+}
+
+void LabelIndex::FindSubstring(const std::string &folded_query,
+                               const std::vector<uint64_t> &query_trigrams,
+                               std::vector<int> &matches) const {
+    // Самый короткий список триграмм запроса; подпись без любой из
+    // триграмм запроса не подходит
+    size_t best = trigramKeys.size();
+    for (uint64_t key : query_trigrams) {
+        auto it = std::lower_bound(trigramKeys.begin(), trigramKeys.end(), key);
+        if (it == trigramKeys.end() || *it != key) {
+            return;
+        }
+        const size_t k = it - trigramKeys.begin();
+        if (best == trigramKeys.size() ||
+            postingStarts[k + 1] - postingStarts[k] <
+                postingStarts[best + 1] - postingStarts[best]) {
+            best = k;
+        }
+    }
+    for (uint32_t p = postingStarts[best]; p < postingStarts[best + 1]; ++p) {
+        const int position = postings[p];
+        if (folded[position].find(folded_query) != std::string::npos) {
+            matches.push_back(position);
+        }
+    }
+}
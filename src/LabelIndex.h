@@ -0,0 +1,46 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// Поиск по подписям элементов большого списка (выпадающие списки
+// справочников) без учёта регистра. Запрос из одного-двух символов ищется
+// по началу подписи через отсортированный массив, более длинный - по любой
+// части подписи через индекс триграмм символов: проверяются только подписи
+// из самого короткого списка триграмм запроса.
+class LabelIndex {
+public:
+    void Build(std::vector<std::string> labels);
+    void Clear();
+
+    size_t Size() const { return labels.size(); }
+    const std::string& Label(size_t position) const {
+        return labels[position];
+    }
+    // Changes on every rebuild, so cached search results can be dropped.
+    // Unique across indexes, so one moved into the place of another (built
+    // on the loader thread) is seen as changed too.
+    unsigned Generation() const { return generation; }
+
+    // Positions of the labels matching 'query', in ascending order.
+    void Find(const std::string& query, std::vector<int>& matches) const;
+
+private:
+    void FindPrefix(const std::string& folded_query,
+                    std::vector<int>& matches) const;
+    void FindSubstring(const std::string& folded_query,
+                       const std::vector<uint64_t>& query_trigrams,
+                       std::vector<int>& matches) const;
+
+    unsigned generation = 0;
+    std::vector<std::string> labels;
+    std::vector<std::string> folded;
+    // Позиции подписей, упорядоченные по folded, для поиска по началу
+    std::vector<int> sortedPositions;
+    // Триграмма trigramKeys[k] встречается в подписях
+    // postings[postingStarts[k]..postingStarts[k + 1])
+    std::vector<uint64_t> trigramKeys;
+    std::vector<uint32_t> postingStarts;
+    std::vector<int> postings;
+};
@@ -11,6 +11,33 @@ struct Payment {
     std::string recipient;
     std::string description;
     int counterparty_id;
+    // Отпечаток строки выписки (PaymentFingerprint); 0 - платёж введён
+    // вручную. Задаётся при импорте, при загрузке из базы не читается.
+    long long fingerprint = 0;
+};
+
+// Результат полнотекстового поиска по назначению платежа
+struct PaymentSearchResult {
+    Payment payment;
+    std::string snippet; // Фрагмент назначения с выделенными совпадениями
+    double rank;         // Меньше - релевантнее
+};
+
+// Параметры постраничной выборки платежей
+enum class PaymentSortColumn { Date, DocNumber, Amount, Description };
+
+struct PaymentPageQuery {
+    PaymentSortColumn sort_column = PaymentSortColumn::Date;
+    bool descending = true;
+    // Подстрока назначения без учёта регистра, как в режиме "в памяти".
+    std::string filter;
+};
+
+// Позиция в выборке: значение столбца сортировки и id строки
+struct PaymentPageKey {
+    std::string text_value;    // Для сортировки по тексту
+    double number_value = 0.0; // Для сортировки по сумме
+    int id = 0;
 };
 
 struct ContractPaymentInfo {
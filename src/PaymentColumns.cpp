@@ -0,0 +1,345 @@
+#include "PaymentColumns.h"
+#include <cmath>
+#include <iostream>
+#include "DataLoader.h"
+#include "DatabaseManager.h"
+
+namespace {
+
+// Удаление строки row из столбца: на её место встаёт последняя строка
+template <typename T>
+void SwapRemove(std::vector<T>& column, size_t row) {
+    column[row] = column.back();
+    column.pop_back();
+}
+
+} // namespace
+
+void PaymentColumns::PutPayment(const Payment& payment) {
+    const uint32_t description = Intern(payment.description);
+    auto it = paymentRowById.find(payment.id);
+    if (it == paymentRowById.end()) {
+        paymentRowById.emplace(payment.id, payments.id.size());
+        payments.id.push_back(payment.id);
+        payments.date.push_back(PackDate(payment.date));
+        payments.amount.push_back(ToKopecks(payment.amount));
+        payments.counterparty_id.push_back(payment.counterparty_id);
+        payments.description.push_back(description);
+        return;
+    }
+    const size_t row = it->second;
+    payments.date[row] = PackDate(payment.date);
+    payments.amount[row] = ToKopecks(payment.amount);
+    payments.counterparty_id[row] = payment.counterparty_id;
+    payments.description[row] = description;
+}
+
+void PaymentColumns::PutDetail(const PaymentDetail& detail) {
+    auto it = detailRowById.find(detail.id);
+    if (it == detailRowById.end()) {
+        detailRowById.emplace(detail.id, details.id.size());
+        details.id.push_back(detail.id);
+        details.payment_id.push_back(detail.payment_id);
+        details.kosgu_id.push_back(detail.kosgu_id);
+        details.contract_id.push_back(detail.contract_id);
+        details.invoice_id.push_back(detail.invoice_id);
+        details.amount.push_back(ToKopecks(detail.amount));
+        return;
+    }
+    const size_t row = it->second;
+    details.payment_id[row] = detail.payment_id;
+    details.kosgu_id[row] = detail.kosgu_id;
+    details.contract_id[row] = detail.contract_id;
+    details.invoice_id[row] = detail.invoice_id;
+    details.amount[row] = ToKopecks(detail.amount);
+}
+
+void PaymentColumns::RemovePayment(int id) {
+    auto it = paymentRowById.find(id);
+    if (it == paymentRowById.end()) {
+        return;
+    }
+    const size_t row = it->second;
+    paymentRowById.erase(it);
+    if (row + 1 != payments.id.size()) {
+        paymentRowById[payments.id.back()] = row;
+    }
+    SwapRemove(payments.id, row);
+    SwapRemove(payments.date, row);
+    SwapRemove(payments.amount, row);
+    SwapRemove(payments.counterparty_id, row);
+    SwapRemove(payments.description, row);
+}
+
+void PaymentColumns::RemoveDetail(int id) {
+    auto it = detailRowById.find(id);
+    if (it == detailRowById.end()) {
+        return;
+    }
+    const size_t row = it->second;
+    detailRowById.erase(it);
+    if (row + 1 != details.id.size()) {
+        detailRowById[details.id.back()] = row;
+    }
+    SwapRemove(details.id, row);
+    SwapRemove(details.payment_id, row);
+    SwapRemove(details.kosgu_id, row);
+    SwapRemove(details.contract_id, row);
+    SwapRemove(details.invoice_id, row);
+    SwapRemove(details.amount, row);
+}
+
+void PaymentColumns::PutContract(const Contract& contract) {
+    if (contract.id < 0) {
+        return;
+    }
+    if (static_cast<size_t>(contract.id) >= contractCounterparty.size()) {
+        contractCounterparty.resize(contract.id + 1, -1);
+    }
+    contractCounterparty[contract.id] = contract.counterparty_id;
+}
+
+void PaymentColumns::RemoveContract(int id) {
+    if (id >= 0 && static_cast<size_t>(id) < contractCounterparty.size()) {
+        contractCounterparty[id] = -1;
+    }
+}
+
+void PaymentColumns::ClearContracts() {
+    contractCounterparty.clear();
+}
+
+PaymentColumns::Total PaymentColumns::SumPayments(int counterparty_id,
+                                                  int32_t date_from,
+                                                  int32_t date_to) const {
+    const size_t count = payments.id.size();
+    const int* counterparties = payments.counterparty_id.data();
+    const int32_t* dates = payments.date.data();
+    const int64_t* amounts = payments.amount.data();
+    // Совпадение - 0 или 1, сумма копится умножением вместо ветвления
+    int64_t kopecks = 0;
+    int64_t rows = 0;
+    for (size_t i = 0; i < count; ++i) {
+        const int64_t hit = (counterparties[i] == counterparty_id) &
+                            (dates[i] >= date_from) & (dates[i] <= date_to);
+        kopecks += amounts[i] * hit;
+        rows += hit;
+    }
+    return {kopecks, rows};
+}
+
+PaymentColumns::Total PaymentColumns::SumDetails(DetailKey key, int id) const {
+    const std::vector<int>& keys = key == DetailKey::Kosgu
+                                       ? details.kosgu_id
+                                       : key == DetailKey::Contract
+                                             ? details.contract_id
+                                             : details.invoice_id;
+    const size_t count = keys.size();
+    const int* ids = keys.data();
+    const int64_t* amounts = details.amount.data();
+    int64_t kopecks = 0;
+    int64_t rows = 0;
+    for (size_t i = 0; i < count; ++i) {
+        const int64_t hit = ids[i] == id;
+        kopecks += amounts[i] * hit;
+        rows += hit;
+    }
+    return {kopecks, rows};
+}
+
+PaymentColumns::Total
+PaymentColumns::SumCounterpartyDetails(int counterparty_id) const {
+    const size_t count = details.contract_id.size();
+    const int* contracts = details.contract_id.data();
+    const int64_t* amounts = details.amount.data();
+    const int* owners = contractCounterparty.data();
+    const size_t known = contractCounterparty.size();
+    int64_t kopecks = 0;
+    int64_t rows = 0;
+    for (size_t i = 0; i < count; ++i) {
+        // Без договора (-1) индекс вне таблицы, строка не считается
+        const size_t contract = static_cast<size_t>(contracts[i]);
+        const int64_t hit =
+            contract < known && owners[contract] == counterparty_id;
+        kopecks += amounts[i] * hit;
+        rows += hit;
+    }
+    return {kopecks, rows};
+}
+
+int32_t PaymentColumns::PackDate(const std::string& date) {
+    if (date.size() != 10 || date[4] != '-' || date[7] != '-') {
+        return 0;
+    }
+    int32_t packed = 0;
+    for (size_t i = 0; i < date.size(); ++i) {
+        if (i == 4 || i == 7) {
+            continue;
+        }
+        if (date[i] < '0' || date[i] > '9') {
+            return 0;
+        }
+        packed = packed * 10 + (date[i] - '0');
+    }
+    return packed;
+}
+
+int64_t PaymentColumns::ToKopecks(double amount) {
+    return static_cast<int64_t>(std::llround(amount * 100.0));
+}
+
+uint32_t PaymentColumns::Intern(const std::string& text) {
+    auto it = stringCodes.find(std::string_view(text));
+    if (it != stringCodes.end()) {
+        return it->second;
+    }
+    const uint32_t code = static_cast<uint32_t>(strings.size());
+    strings.push_back(text);
+    stringCodes.emplace(std::string_view(strings.back()), code);
+    return code;
+}
+
+void PaymentSnapshot::SetDatabaseManager(DatabaseManager* manager) {
+    dbManager = manager;
+    columns.reset();
+    settingsStale = true;
+    rebuildWanted = true;
+}
+
+void PaymentSnapshot::SetDataLoader(DataLoader* dataLoader) {
+    loader = dataLoader;
+}
+
+void PaymentSnapshot::Update() {
+    if (!dbManager || !loader || !dbManager->is_open()) {
+        return;
+    }
+    if (settingsStale) {
+        settingsStale = false;
+        const bool was_enabled = enabled;
+        enabled = dbManager->getSettings().payment_snapshot;
+        if (!enabled) {
+            columns.reset(); // Память снимка освобождается сразу
+        } else if (!was_enabled) {
+            rebuildWanted = true;
+        }
+    }
+    if (enabled && rebuildWanted) {
+        rebuildWanted = false;
+        Rebuild();
+    }
+}
+
+void PaymentSnapshot::OnDatabaseChanged(const DbChange& change) {
+    if (change.table == DbTable::Settings) {
+        settingsStale = true;
+        return;
+    }
+    if (change.table == DbTable::Contracts) {
+        OnContractChanged(change);
+        return;
+    }
+    if (change.table != DbTable::Payments &&
+        change.table != DbTable::PaymentDetails) {
+        return;
+    }
+    if (!enabled || !dbManager || !loader) {
+        return;
+    }
+    // Идущая сборка могла прочитать таблицу до этого изменения
+    if (change.kind == DbChangeKind::Reload || loader->IsLoading(this)) {
+        columns.reset();
+        rebuildWanted = true;
+        return;
+    }
+    if (!columns) {
+        return;
+    }
+    const int id = static_cast<int>(change.id);
+    if (change.table == DbTable::Payments) {
+        Payment payment;
+        if (change.kind != DbChangeKind::Delete &&
+            dbManager->getPaymentById(id, payment)) {
+            columns->PutPayment(payment);
+        } else {
+            columns->RemovePayment(id);
+        }
+    } else {
+        PaymentDetail detail;
+        if (change.kind != DbChangeKind::Delete &&
+            dbManager->getPaymentDetailById(id, detail)) {
+            columns->PutDetail(detail);
+        } else {
+            columns->RemoveDetail(id);
+        }
+    }
+}
+
+void PaymentSnapshot::OnContractChanged(const DbChange& change) {
+    if (!enabled || !dbManager || !loader) {
+        return;
+    }
+    // Идущая сборка или чтение договоров могли прочитать таблицу до этого
+    // изменения; новое чтение применится после них
+    if (change.kind == DbChangeKind::Reload || loader->IsLoading(this) ||
+        loader->IsLoading(&contractsLoad)) {
+        LoadContracts();
+        return;
+    }
+    if (!columns) {
+        return;
+    }
+    const int id = static_cast<int>(change.id);
+    Contract contract;
+    if (change.kind != DbChangeKind::Delete &&
+        dbManager->getContractById(id, contract)) {
+        columns->PutContract(contract);
+    } else {
+        columns->RemoveContract(id);
+    }
+}
+
+void PaymentSnapshot::LoadContracts() {
+    loader->Load<std::vector<Contract>>(
+        &contractsLoad, [](DatabaseManager& db) { return db.getContracts(); },
+        [this](std::vector<Contract>& contracts) {
+            if (!columns) {
+                return; // Сборка снимка прочитает договоры сама
+            }
+            columns->ClearContracts();
+            for (const Contract& contract : contracts) {
+                columns->PutContract(contract);
+            }
+        });
+}
+
+void PaymentSnapshot::Rebuild() {
+    // Пустой указатель - чтение не удалось; снимок остаётся выключенным до
+    // следующего Reload, а не перестраивается на каждом кадре
+    loader->Load<std::unique_ptr<PaymentColumns>>(
+        this,
+        [](DatabaseManager& db) {
+            auto built = std::make_unique<PaymentColumns>();
+            const bool ok =
+                db.forEachPayment([&built](const Payment& payment) {
+                    built->PutPayment(payment);
+                }) &&
+                db.forEachPaymentDetail([&built](const PaymentDetail& detail) {
+                    built->PutDetail(detail);
+                });
+            for (const Contract& contract : db.getContracts()) {
+                built->PutContract(contract);
+            }
+            if (!ok) {
+                std::cerr << "Failed to build the payment snapshot"
+                          << std::endl;
+                built.reset();
+            }
+            return built;
+        },
+        [this](std::unique_ptr<PaymentColumns>& built) {
+            if (enabled) {
+                columns = std::move(built);
+            }
+        });
+}
@@ -0,0 +1,127 @@
+#pragma once
+
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+#include "ChangeBus.h"
+#include "Contract.h"
+#include "Payment.h"
+#include "PaymentDetail.h"
+
+class DataLoader;
+class DatabaseManager;
+
+// Столбцовый снимок Payments и PaymentDetails для итогов: каждое поле
+// лежит в своём непрерывном массиве, суммы хранятся в копейках, даты -
+// числом ГГГГММДД, назначения - кодами в общем пуле строк; контрагенты
+// договоров - таблицей по id договора. Подсчёт итога
+// проходит по двум-трём массивам чисел без ветвлений и без обращений к
+// строкам, поэтому компилятор векторизует цикл.
+// Порядок строк не определён: удаление переносит последнюю строку на место
+// удалённой.
+class PaymentColumns {
+public:
+    struct Payments {
+        std::vector<int> id;
+        std::vector<int32_t> date;   // ГГГГММДД, 0 - дата не разобрана
+        std::vector<int64_t> amount; // Копейки
+        std::vector<int> counterparty_id;
+        std::vector<uint32_t> description; // Код строки в Description()
+    };
+    struct Details {
+        std::vector<int> id;
+        std::vector<int> payment_id;
+        std::vector<int> kosgu_id;
+        std::vector<int> contract_id;
+        std::vector<int> invoice_id;
+        std::vector<int64_t> amount; // Копейки
+    };
+
+    struct Total {
+        long long kopecks = 0;
+        long long rows = 0;
+    };
+    enum class DetailKey { Kosgu, Contract, Invoice };
+
+    // Inserts the row or replaces the row with the same id.
+    void PutPayment(const Payment& payment);
+    void PutDetail(const PaymentDetail& detail);
+    void RemovePayment(int id);
+    void RemoveDetail(int id);
+    // Counterparty of a contract, for the sums through
+    // PaymentDetails.contract_id.
+    void PutContract(const Contract& contract);
+    void RemoveContract(int id);
+    void ClearContracts();
+
+    const Payments& PaymentRows() const { return payments; }
+    const Details& DetailRows() const { return details; }
+    // Text of a description code. Codes of removed payments stay in the
+    // pool until the snapshot is rebuilt.
+    const std::string& Description(uint32_t code) const { return strings[code]; }
+
+    // Payments of the counterparty dated within [date_from, date_to]
+    // (ГГГГММДД, inclusive).
+    Total SumPayments(int counterparty_id, int32_t date_from = 0,
+                      int32_t date_to = INT32_MAX) const;
+    // Payment details referring to the КОСГУ / contract / invoice 'id'.
+    Total SumDetails(DetailKey key, int id) const;
+    // Payment details whose contract belongs to the counterparty: the rows
+    // DatabaseManager::getPaymentInfoForCounterparty lists.
+    Total SumCounterpartyDetails(int counterparty_id) const;
+
+    // "ГГГГ-ММ-ДД" -> ГГГГММДД; 0 if the text is not such a date.
+    static int32_t PackDate(const std::string& date);
+    static int64_t ToKopecks(double amount);
+
+private:
+    uint32_t Intern(const std::string& text);
+
+    Payments payments;
+    Details details;
+    std::unordered_map<int, size_t> paymentRowById;
+    std::unordered_map<int, size_t> detailRowById;
+    // Контрагент договора по id договора, -1 - договора нет
+    std::vector<int> contractCounterparty;
+    // deque не перемещает строки при росте, ключи stringCodes остаются
+    // действительными
+    std::deque<std::string> strings;
+    std::unordered_map<std::string_view, uint32_t> stringCodes;
+};
+
+// Владелец снимка в потоке интерфейса (UIManager). Снимок строится в
+// фоне через DataLoader после открытия базы и затем обновляется по
+// событиям ChangeBus построчно; Reload таблицы перестраивает его целиком.
+// Выключается настройкой payment_snapshot.
+class PaymentSnapshot {
+public:
+    void SetDatabaseManager(DatabaseManager* manager);
+    void SetDataLoader(DataLoader* dataLoader);
+    // UI thread, once per frame after the changes are dispatched: reads the
+    // setting and starts a rebuild when one is needed.
+    void Update();
+    void OnDatabaseChanged(const DbChange& change);
+
+    // nullptr while the snapshot is disabled or being built.
+    const PaymentColumns* Columns() const { return columns.get(); }
+
+private:
+    void Rebuild();
+    // Договоры перечитываются отдельно от платежей: их Reload не
+    // перестраивает весь снимок
+    void LoadContracts();
+    void OnContractChanged(const DbChange& change);
+
+    DatabaseManager* dbManager = nullptr;
+    DataLoader* loader = nullptr;
+    std::unique_ptr<PaymentColumns> columns;
+    bool settingsStale = true;
+    bool enabled = false;
+    bool rebuildWanted = true;
+    // Владелец чтения договоров в DataLoader
+    const char contractsLoad = 0;
+};
@@ -0,0 +1,61 @@
+#include "PaymentFingerprint.h"
+#include <cstring>
+
+namespace {
+
+// FNV-1a, 64 бита
+const uint64_t FNV_OFFSET = 14695981039346656037ull;
+const uint64_t FNV_PRIME = 1099511628211ull;
+
+void hash_bytes(uint64_t &hash, const void *data, size_t size) {
+    const unsigned char *bytes = static_cast<const unsigned char *>(data);
+    for (size_t i = 0; i < size; ++i) {
+        hash ^= bytes[i];
+        hash *= FNV_PRIME;
+    }
+}
+
+void hash_field(uint64_t &hash, const std::string &value) {
+    hash_bytes(hash, value.data(), value.size());
+    const char separator = '\x1f';
+    hash_bytes(hash, &separator, 1);
+}
+
+// Перемешивание splitmix64: близкие входы дают далёкие результаты
+uint64_t mix(uint64_t value) {
+    value += 0x9E3779B97F4A7C15ull;
+    value = (value ^ (value >> 30)) * 0xBF58476D1CE4E5B9ull;
+    value = (value ^ (value >> 27)) * 0x94D049BB133111EBull;
+    return value ^ (value >> 31);
+}
+
+} // namespace
+
+namespace PaymentFingerprint {
+
+uint64_t Content(const Payment &payment,
+                 const std::string &counterparty_name) {
+    uint64_t hash = FNV_OFFSET;
+    hash_field(hash, payment.date);
+    hash_field(hash, payment.doc_number);
+    hash_field(hash, payment.type);
+    // Сумма хранится в REAL без потерь, поэтому хешируются её биты
+    uint64_t amount_bits = 0;
+    std::memcpy(&amount_bits, &payment.amount, sizeof(amount_bits));
+    hash_bytes(hash, &amount_bits, sizeof(amount_bits));
+    hash_field(hash, payment.recipient);
+    hash_field(hash, counterparty_name);
+    hash_field(hash, payment.description);
+    return hash;
+}
+
+long long Sequence::Next(uint64_t content) {
+    unsigned occurrence = occurrences[content]++;
+    uint64_t fingerprint = mix(content ^ mix(occurrence));
+    if (fingerprint == 0) {
+        fingerprint = 1; // 0 означает "нет отпечатка"
+    }
+    return static_cast<long long>(fingerprint);
+}
+
+} // namespace PaymentFingerprint
@@ -0,0 +1,28 @@
+#pragma once
+
+#include "Payment.h"
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+
+// Отпечаток строки банковской выписки. Хранится в Payments.fingerprint и
+// позволяет при повторном импорте пересекающейся выписки пропускать уже
+// загруженные строки.
+namespace PaymentFingerprint {
+
+// Hash of the fields that identify a statement row: date, document number,
+// type, amount, recipient, counterparty name and description.
+uint64_t Content(const Payment &payment, const std::string &counterparty_name);
+
+// Одинаковые строки (например, два равных перевода за день) различаются
+// номером повторения в порядке файла, поэтому не склеиваются в одну.
+class Sequence {
+public:
+    // Fingerprint of the next row with this content hash. Never 0.
+    long long Next(uint64_t content);
+
+private:
+    std::unordered_map<uint64_t, unsigned> occurrences;
+};
+
+} // namespace PaymentFingerprint
@@ -0,0 +1,144 @@
+#include "PaymentsPager.h"
+#include <algorithm>
+
+PaymentsPager::PaymentsPager(int page_size, size_t max_cached_pages)
+    : pageSize(page_size), maxCachedPages(max_cached_pages) {}
+
+static bool HasFilter(const PaymentPageQuery &query) {
+    return !query.filter.empty();
+}
+
+PaymentsPager::FirstPage
+PaymentsPager::ReadFirstPage(DatabaseManager &db,
+                             const PaymentPageQuery &query, int page_size) {
+    FirstPage first;
+    first.query = query;
+    if (HasFilter(query)) {
+        db.getPaymentIds(query, first.ids);
+        first.rowCount = static_cast<int>(first.ids.size());
+        first.rows = db.getPaymentsByIds(
+            first.ids.data(),
+            std::min(first.ids.size(), static_cast<size_t>(page_size)));
+        return first;
+    }
+    first.rowCount = db.countPayments(query);
+    first.rows = db.getPaymentsPage(query, nullptr, page_size);
+    return first;
+}
+
+void PaymentsPager::Assign(DatabaseManager *manager, FirstPage first) {
+    Clear();
+    dbManager = manager;
+    query = std::move(first.query);
+    rowCount = first.rowCount;
+    byIds = HasFilter(query);
+    ids = std::move(first.ids);
+    StorePage(0, std::move(first.rows));
+}
+
+void PaymentsPager::Clear() {
+    dbManager = nullptr;
+    rowCount = 0;
+    ids.clear();
+    byIds = false;
+    pages.clear();
+    lru.clear();
+    pageAnchors.clear();
+}
+
+PaymentPageKey PaymentsPager::KeyOf(const Payment &payment) const {
+    PaymentPageKey key;
+    switch (query.sort_column) {
+    case PaymentSortColumn::DocNumber:
+        key.text_value = payment.doc_number;
+        break;
+    case PaymentSortColumn::Amount:
+        key.number_value = payment.amount;
+        break;
+    case PaymentSortColumn::Description:
+        key.text_value = payment.description;
+        break;
+    case PaymentSortColumn::Date:
+    default:
+        key.text_value = payment.date;
+        break;
+    }
+    key.id = payment.id;
+    return key;
+}
+
+const Payment *PaymentsPager::GetRow(int index) {
+    if (index < 0 || index >= rowCount) {
+        return nullptr;
+    }
+    const std::vector<Payment> *rows = LoadPage(index / pageSize);
+    size_t offset = index % pageSize;
+    if (!rows || offset >= rows->size()) {
+        return nullptr;
+    }
+    return &(*rows)[offset];
+}
+
+const std::vector<Payment> *PaymentsPager::LoadPage(int page) {
+    auto cached = pages.find(page);
+    if (cached != pages.end()) {
+        lru.splice(lru.begin(), lru, cached->second.lruPosition);
+        return &cached->second.rows;
+    }
+    if (!dbManager) {
+        return nullptr;
+    }
+
+    std::vector<Payment> rows;
+    if (byIds) {
+        const size_t start = static_cast<size_t>(page) * pageSize;
+        if (start >= ids.size()) {
+            return nullptr;
+        }
+        const size_t count =
+            std::min(ids.size() - start, static_cast<size_t>(pageSize));
+        rows = dbManager->getPaymentsByIds(ids.data() + start, count);
+    } else if (page == 0) {
+        rows = dbManager->getPaymentsPage(query, nullptr, pageSize);
+    } else {
+        // Ключ начала страницы: либо уже известен, либо находится сдвигом
+        // от ближайшей известной страницы выше
+        auto anchor = pageAnchors.find(page);
+        if (anchor == pageAnchors.end()) {
+            auto nearest = pageAnchors.lower_bound(page);
+            const PaymentPageKey *from = nullptr;
+            int from_page = 0;
+            if (nearest != pageAnchors.begin()) {
+                --nearest;
+                from = &nearest->second;
+                from_page = nearest->first;
+            }
+            PaymentPageKey key;
+            if (!dbManager->getPaymentPageKey(
+                    query, from, (page - from_page) * pageSize - 1, key)) {
+                return nullptr;
+            }
+            anchor = pageAnchors.emplace(page, key).first;
+        }
+        rows = dbManager->getPaymentsPage(query, &anchor->second, pageSize);
+    }
+
+    return StorePage(page, std::move(rows));
+}
+
+const std::vector<Payment> *
+PaymentsPager::StorePage(int page, std::vector<Payment> rows) {
+    if (!rows.empty()) {
+        pageAnchors[page + 1] = KeyOf(rows.back());
+    }
+
+    if (pages.size() >= maxCachedPages) {
+        pages.erase(lru.back());
+        lru.pop_back();
+    }
+    lru.push_front(page);
+    CachedPage &entry = pages[page];
+    entry.rows = std::move(rows);
+    entry.lruPosition = lru.begin();
+    return &entry.rows;
+}
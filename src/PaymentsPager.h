@@ -0,0 +1,72 @@
+#pragma once
+
+#include <list>
+#include <map>
+#include <unordered_map>
+#include <vector>
+#include "DatabaseManager.h"
+
+// Окно просмотра платежей, загружаемое страницами по мере прокрутки.
+// Страницы читаются keyset-запросами (DatabaseManager::getPaymentsPage) и
+// хранятся в LRU-кэше ограниченного размера, так что память не зависит от
+// числа платежей в базе. С фильтром по назначению вместо этого один раз
+// читается упорядоченный список id найденных платежей, и страница - это
+// выборка по 200 id: фильтр не вычисляется заново для каждой страницы.
+// Смена запроса (фильтр, сортировка, правки) самая дорогая: подсчёт строк
+// и первая страница читаются в фоне (ReadFirstPage через DataLoader) и
+// передаются в Assign.
+class PaymentsPager {
+public:
+    explicit PaymentsPager(int page_size = 200, size_t max_cached_pages = 16);
+
+    struct FirstPage {
+        PaymentPageQuery query;
+        int rowCount = 0;
+        std::vector<Payment> rows;
+        std::vector<int> ids; // Все найденные id, только с фильтром
+    };
+    // Counts the rows of 'query' and reads its first page (with a filter,
+    // the ids of all its rows). Safe to call on any thread with its own
+    // connection.
+    static FirstPage ReadFirstPage(DatabaseManager& db, const PaymentPageQuery& query, int page_size);
+
+    // Shows 'first' in place of the previous query; further pages are read
+    // through 'dbManager' on demand.
+    void Assign(DatabaseManager* dbManager, FirstPage first);
+    // Drops all rows; IsReady() becomes false.
+    void Clear();
+
+    bool IsReady() const { return dbManager != nullptr; }
+    const PaymentPageQuery& Query() const { return query; }
+    int RowCount() const { return rowCount; }
+    int PageSize() const { return pageSize; }
+
+    // Returns the row or nullptr if it could not be loaded. The pointer is
+    // valid until the next GetRow() call that loads another page.
+    const Payment* GetRow(int index);
+
+private:
+    const std::vector<Payment>* LoadPage(int page);
+    const std::vector<Payment>* StorePage(int page, std::vector<Payment> rows);
+    PaymentPageKey KeyOf(const Payment& payment) const;
+
+    DatabaseManager* dbManager = nullptr;
+    PaymentPageQuery query;
+    int pageSize;
+    size_t maxCachedPages;
+    int rowCount = 0;
+
+    // Непустой при фильтре: строки страницы N - ids[N * pageSize...]
+    std::vector<int> ids;
+    bool byIds = false;
+
+    // Ключ последней строки страницы N-1 для каждой известной страницы N
+    std::map<int, PaymentPageKey> pageAnchors;
+
+    struct CachedPage {
+        std::vector<Payment> rows;
+        std::list<int>::iterator lruPosition;
+    };
+    std::unordered_map<int, CachedPage> pages;
+    std::list<int> lru; // Спереди - недавно использованные
+};
@@ -0,0 +1,107 @@
+#include "ReferenceCache.h"
+
+static const char *const UNKNOWN_LABEL = "N/A";
+
+void ReferenceCache::SetDatabaseManager(DatabaseManager *manager) {
+    dbManager = manager;
+    Invalidate();
+}
+
+void ReferenceCache::BeginFrame() {
+    if (!dbManager) {
+        return;
+    }
+    counterparties.wanted = dbManager->getTableVersion(DbTable::Counterparties);
+    kosgu.wanted = dbManager->getTableVersion(DbTable::Kosgu);
+    contracts.wanted = dbManager->getTableVersion(DbTable::Contracts);
+    invoices.wanted = dbManager->getTableVersion(DbTable::Invoices);
+}
+
+void ReferenceCache::SetDataLoader(DataLoader *dataLoader) {
+    loader = dataLoader;
+}
+
+void ReferenceCache::Invalidate() {
+    counterparties.stale = true;
+    kosgu.stale = true;
+    contracts.stale = true;
+    invoices.stale = true;
+}
+
+bool ReferenceCache::IsLoading() const {
+    return loader &&
+           (loader->IsLoading(&counterparties) || loader->IsLoading(&kosgu) ||
+            loader->IsLoading(&contracts) || loader->IsLoading(&invoices));
+}
+
+template <typename Entry>
+const ReferenceTable<Entry> &
+ReferenceCache::Fresh(ReferenceTable<Entry> &table,
+                      std::vector<Entry> (DatabaseManager::*read)()) {
+    if (!table.stale && table.version == table.wanted) {
+        return table;
+    }
+    if (!dbManager || !dbManager->is_open()) {
+        table.Assign({});
+        table.version = table.wanted;
+        table.stale = false;
+        return table;
+    }
+    // Идущее чтение не отменяется, иначе при импорте каждая порция
+    // откладывала бы таблицу снова; что изменилось после его начала,
+    // прочитает следующее
+    if (!loader || loader->IsLoading(&table)) {
+        return table;
+    }
+    const unsigned long long version = table.wanted;
+    table.stale = false;
+    std::string Entry::*label_field = table.LabelField();
+    loader->Load<std::unique_ptr<ReferenceTable<Entry>>>(
+        &table,
+        [read, label_field](DatabaseManager &db) {
+            auto built = std::make_unique<ReferenceTable<Entry>>(label_field);
+            built->Assign((db.*read)());
+            return built;
+        },
+        [&table, version](std::unique_ptr<ReferenceTable<Entry>> &built) {
+            table.Replace(std::move(*built));
+            table.version = version;
+        });
+    return table;
+}
+
+const ReferenceTable<Counterparty> &ReferenceCache::Counterparties() {
+    return Fresh(counterparties, &DatabaseManager::getCounterparties);
+}
+
+const ReferenceTable<Kosgu> &ReferenceCache::KosguEntries() {
+    return Fresh(kosgu, &DatabaseManager::getKosguEntries);
+}
+
+const ReferenceTable<Contract> &ReferenceCache::Contracts() {
+    return Fresh(contracts, &DatabaseManager::getContracts);
+}
+
+const ReferenceTable<Invoice> &ReferenceCache::Invoices() {
+    return Fresh(invoices, &DatabaseManager::getInvoices);
+}
+
+const char *ReferenceCache::CounterpartyName(int id) {
+    const Counterparty *entry = Counterparties().Find(id);
+    return entry ? entry->name.c_str() : UNKNOWN_LABEL;
+}
+
+const char *ReferenceCache::KosguCode(int id) {
+    const Kosgu *entry = KosguEntries().Find(id);
+    return entry ? entry->code.c_str() : UNKNOWN_LABEL;
+}
+
+const char *ReferenceCache::ContractNumber(int id) {
+    const Contract *entry = Contracts().Find(id);
+    return entry ? entry->number.c_str() : UNKNOWN_LABEL;
+}
+
+const char *ReferenceCache::InvoiceNumber(int id) {
+    const Invoice *entry = Invoices().Find(id);
+    return entry ? entry->number.c_str() : UNKNOWN_LABEL;
+}
@@ -0,0 +1,119 @@
+#pragma once
+
+#include <memory>
+#include <unordered_map>
+#include <vector>
+#include "Contract.h"
+#include "Counterparty.h"
+#include "DataLoader.h"
+#include "DatabaseManager.h"
+#include "Invoice.h"
+#include "Kosgu.h"
+#include "LabelIndex.h"
+
+// Записи одного справочника, индекс id -> позиция в entries и индекс
+// поиска по подписи записи (поле labelField) для выпадающих списков
+template <typename Entry>
+class ReferenceTable {
+public:
+    explicit ReferenceTable(std::string Entry::*label_field)
+        : labelField(label_field) {}
+
+    const std::vector<Entry>& Entries() const { return entries; }
+    // Positions in Entries() match positions in the label index.
+    const LabelIndex& Labels() const { return labels; }
+
+    // Position of the entry with this id in Entries(), -1 if none.
+    int IndexOf(int id) const {
+        auto it = indexById.find(id);
+        return it != indexById.end() ? static_cast<int>(it->second) : -1;
+    }
+
+    // Returns nullptr if no entry has this id.
+    const Entry* Find(int id) const {
+        auto it = indexById.find(id);
+        return it != indexById.end() ? &entries[it->second] : nullptr;
+    }
+
+    // Takes the entries and indexes of 'built' (read and indexed on the
+    // loader thread); the versions below stay.
+    void Replace(ReferenceTable&& built) {
+        entries = std::move(built.entries);
+        indexById = std::move(built.indexById);
+        labels = std::move(built.labels);
+    }
+
+    std::string Entry::*LabelField() const { return labelField; }
+
+    void Assign(std::vector<Entry> rows) {
+        entries = std::move(rows);
+        indexById.clear();
+        indexById.reserve(entries.size());
+        for (size_t i = 0; i < entries.size(); ++i) {
+            indexById.emplace(entries[i].id, i);
+        }
+        std::vector<std::string> label_texts;
+        label_texts.reserve(entries.size());
+        for (const auto& entry : entries) {
+            label_texts.push_back(entry.*labelField);
+        }
+        labels.Build(std::move(label_texts));
+    }
+
+    // Версия таблицы в базе, по которой построены entries, и версия,
+    // замеченная в начале кадра
+    unsigned long long version = 0;
+    unsigned long long wanted = 0;
+    bool stale = true; // Перечитать независимо от версии
+
+private:
+    std::string Entry::*labelField;
+    std::vector<Entry> entries;
+    std::unordered_map<int, size_t> indexById;
+    LabelIndex labels;
+};
+
+// Справочники для выпадающих списков и подписей по id, общие для всех окон.
+// Таблица перечитывается при первом обращении после того, как её изменили
+// (DatabaseManager::getTableVersion), а не на каждом кадре или в каждом окне.
+// Чтение и индекс подписей строятся в фоне через DataLoader; до их прихода
+// видна прежняя таблица, а изменения, сделанные во время чтения (очередные
+// порции импорта), подхватывает следующее чтение. Новая таблица
+// подставляется в DataLoader::Deliver в начале кадра, так что ссылки на
+// записи остаются действительными до конца кадра. Используется только из
+// потока интерфейса.
+class ReferenceCache {
+public:
+    void SetDatabaseManager(DatabaseManager* manager);
+    void SetDataLoader(DataLoader* dataLoader);
+    // Picks up table changes committed since the previous frame.
+    void BeginFrame();
+    // Forces every table to be reloaded on next access ("Обновить").
+    void Invalidate();
+    // True while a dictionary is being read in the background.
+    bool IsLoading() const;
+
+    const ReferenceTable<Counterparty>& Counterparties();
+    const ReferenceTable<Kosgu>& KosguEntries();
+    const ReferenceTable<Contract>& Contracts();
+    const ReferenceTable<Invoice>& Invoices();
+
+    // Labels for table cells and combo previews; "N/A" for unknown ids.
+    const char* CounterpartyName(int id);
+    const char* KosguCode(int id);
+    const char* ContractNumber(int id);
+    const char* InvoiceNumber(int id);
+
+private:
+    template <typename Entry>
+    const ReferenceTable<Entry>& Fresh(
+        ReferenceTable<Entry>& table,
+        std::vector<Entry> (DatabaseManager::*read)());
+
+    DatabaseManager* dbManager = nullptr;
+    DataLoader* loader = nullptr;
+    ReferenceTable<Counterparty> counterparties{&Counterparty::name};
+    ReferenceTable<Kosgu> kosgu{&Kosgu::code};
+    ReferenceTable<Contract> contracts{&Contract::number};
+    ReferenceTable<Invoice> invoices{&Invoice::number};
+};
@@ -0,0 +1,161 @@
+#include "RegexMatcher.h"
+#include "BuiltinMatchers.h"
+#include <mutex>
+#include <regex>
+#include <unordered_map>
+
+#ifdef HAVE_RE2
+#include <re2/re2.h>
+#endif
+
+namespace {
+
+class StdRegexMatcher : public RegexMatcher {
+public:
+    explicit StdRegexMatcher(const std::string &pattern) : re(pattern) {}
+
+    bool Search(std::string_view text, std::vector<std::string_view> &groups,
+                size_t pos) const override {
+        groups.clear();
+        if (pos > text.size()) {
+            return false;
+        }
+        std::cmatch match;
+        auto flags = pos > 0 ? std::regex_constants::match_prev_avail
+                             : std::regex_constants::match_default;
+        if (!std::regex_search(text.data() + pos, text.data() + text.size(),
+                               match, re, flags)) {
+            return false;
+        }
+        groups.reserve(match.size());
+        for (size_t i = 0; i < match.size(); ++i) {
+            if (match[i].matched) {
+                groups.emplace_back(match[i].first, match[i].length());
+            } else {
+                groups.emplace_back();
+            }
+        }
+        return true;
+    }
+
+    int GroupCount() const override {
+        return static_cast<int>(re.mark_count());
+    }
+    const char *Backend() const override { return "std::regex"; }
+
+private:
+    std::regex re;
+};
+
+#ifdef HAVE_RE2
+class Re2Matcher : public RegexMatcher {
+public:
+    explicit Re2Matcher(const std::string &pattern)
+        : re(pattern, RE2::Quiet) {}
+
+    bool Ok() const { return re.ok(); }
+
+    bool Search(std::string_view text, std::vector<std::string_view> &groups,
+                size_t pos) const override {
+        groups.clear();
+        if (pos > text.size()) {
+            return false;
+        }
+        const int count = re.NumberOfCapturingGroups() + 1;
+        // Шаблоны извлечения реквизитов содержат всего несколько групп
+        re2::StringPiece inline_submatch[8];
+        std::vector<re2::StringPiece> heap_submatch;
+        re2::StringPiece *submatch = inline_submatch;
+        if (count > 8) {
+            heap_submatch.resize(count);
+            submatch = heap_submatch.data();
+        }
+        if (!re.Match(re2::StringPiece(text.data(), text.size()), pos,
+                      text.size(), RE2::UNANCHORED, submatch, count)) {
+            return false;
+        }
+        groups.reserve(count);
+        for (int i = 0; i < count; ++i) {
+            const re2::StringPiece &piece = submatch[i];
+            if (piece.data()) {
+                groups.emplace_back(piece.data(), piece.size());
+            } else {
+                groups.emplace_back();
+            }
+        }
+        return true;
+    }
+
+    int GroupCount() const override { return re.NumberOfCapturingGroups(); }
+    const char *Backend() const override { return "RE2"; }
+
+private:
+    RE2 re;
+};
+#endif
+
+struct CacheEntry {
+    std::shared_ptr<const RegexMatcher> matcher;
+    std::string error;
+};
+
+// Шаблоны из поля редактирования в окне импорта попадают в кэш на каждое
+// нажатие клавиши, поэтому размер кэша ограничен.
+const size_t MAX_CACHED_PATTERNS = 256;
+
+std::mutex cache_mutex;
+std::unordered_map<std::string, CacheEntry> cache;
+
+CacheEntry compile_generic(const std::string &pattern) {
+    CacheEntry entry;
+#ifdef HAVE_RE2
+    auto re2_matcher = std::make_shared<Re2Matcher>(pattern);
+    if (re2_matcher->Ok()) {
+        entry.matcher = re2_matcher;
+        return entry;
+    }
+#endif
+    try {
+        entry.matcher = std::make_shared<StdRegexMatcher>(pattern);
+    } catch (const std::regex_error &e) {
+        entry.error = e.what();
+    }
+    return entry;
+}
+
+// Встроенные шаблоны обслуживаются сканерами из BuiltinMatchers
+CacheEntry compile(const std::string &pattern) {
+    CacheEntry entry;
+    entry.matcher = BuiltinMatchers::Find(pattern);
+    if (!entry.matcher) {
+        entry = compile_generic(pattern);
+    }
+    return entry;
+}
+
+} // namespace
+
+std::shared_ptr<const RegexMatcher>
+RegexMatcher::Get(const std::string &pattern, std::string *error) {
+    std::lock_guard<std::mutex> lock(cache_mutex);
+    auto it = cache.find(pattern);
+    if (it == cache.end()) {
+        if (cache.size() >= MAX_CACHED_PATTERNS) {
+            cache.clear();
+        }
+        it = cache.emplace(pattern, compile(pattern)).first;
+    }
+    if (!it->second.matcher && error) {
+        *error = it->second.error;
+    }
+    return it->second.matcher;
+}
+
+std::shared_ptr<const RegexMatcher>
+RegexMatcher::CompileEngine(const std::string &pattern, std::string *error) {
+    CacheEntry entry = compile_generic(pattern);
+    if (!entry.matcher && error) {
+        *error = entry.error;
+    }
+    return entry.matcher;
+}
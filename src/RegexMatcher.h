@@ -0,0 +1,41 @@
+#pragma once
+
+#include <memory>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// Скомпилированное регулярное выражение для поиска в назначении платежа.
+// Экземпляры неизменяемы и могут одновременно использоваться из разных
+// потоков (импорт разбирает строки параллельно).
+//
+// При сборке с RE2 (HAVE_RE2) выражения выполняются на его автомате: время
+// поиска линейно, а текст и шаблон рассматриваются как UTF-8, поэтому
+// классы вроде [А-Я] и "." работают с кириллическими символами целиком.
+// Шаблоны, которые RE2 не поддерживает (обратные ссылки, просмотр вперёд),
+// и сборки без RE2 используют std::regex (ECMAScript).
+class RegexMatcher {
+public:
+    virtual ~RegexMatcher() = default;
+
+    // Finds the first match in 'text' at or after 'pos'. On success
+    // groups[0] is the whole match and groups[i] is capture group i (empty
+    // if the group did not participate).
+    virtual bool Search(std::string_view text,
+                        std::vector<std::string_view> &groups,
+                        size_t pos = 0) const = 0;
+
+    virtual int GroupCount() const = 0;
+    virtual const char *Backend() const = 0;
+
+    // Returns the compiled matcher for 'pattern' from the process-wide
+    // cache, compiling it on first use. Returns nullptr and fills 'error'
+    // if the pattern is invalid (failures are cached too).
+    static std::shared_ptr<const RegexMatcher>
+    Get(const std::string &pattern, std::string *error = nullptr);
+
+    // Compiles 'pattern' with the regex engine (RE2 or std::regex), without
+    // the cache and without the built-in scanners of BuiltinMatchers.
+    static std::shared_ptr<const RegexMatcher>
+    CompileEngine(const std::string &pattern, std::string *error = nullptr);
+};
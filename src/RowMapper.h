@@ -0,0 +1,83 @@
+#pragma once
+
+#include <sqlite3.h>
+#include <string>
+#include <tuple>
+#include <utility>
+#include <vector>
+
+// Чтение строк результата sqlite3_step напрямую в поля структур.
+// Соответствие столбцов задаётся кортежем указателей на члены в порядке
+// столбцов SELECT:
+//
+//     static const auto kosgu_columns =
+//         RowMapper::Columns(&Kosgu::id, &Kosgu::code, &Kosgu::name);
+//     RowMapper::ReadAll(stmt, kosgu_columns, entries);
+//
+// Тип каждого поля известен при компиляции, поэтому значения читаются
+// нужной sqlite3_column_* без промежуточного текста и без поиска столбцов
+// по имени.
+namespace RowMapper {
+
+// NULL читается как -1 для целых (идентификатор "не выбрано"), 0.0 для
+// вещественных и пустая строка для текста
+inline void ReadColumn(sqlite3_stmt *stmt, int index, int &value) {
+    value = sqlite3_column_type(stmt, index) == SQLITE_NULL
+                ? -1
+                : sqlite3_column_int(stmt, index);
+}
+
+inline void ReadColumn(sqlite3_stmt *stmt, int index, long long &value) {
+    value = sqlite3_column_int64(stmt, index);
+}
+
+inline void ReadColumn(sqlite3_stmt *stmt, int index, double &value) {
+    value = sqlite3_column_double(stmt, index);
+}
+
+inline void ReadColumn(sqlite3_stmt *stmt, int index, std::string &value) {
+    const unsigned char *text = sqlite3_column_text(stmt, index);
+    if (text) {
+        value.assign(reinterpret_cast<const char *>(text),
+                     sqlite3_column_bytes(stmt, index));
+    } else {
+        value.clear();
+    }
+}
+
+template <typename Struct, typename... Fields>
+constexpr std::tuple<Fields Struct::*...> Columns(Fields Struct::*...fields) {
+    return std::tuple<Fields Struct::*...>(fields...);
+}
+
+template <typename Struct, typename Tuple, size_t... Index>
+void ReadRowImpl(sqlite3_stmt *stmt, int first_column, Struct &row,
+                 const Tuple &columns, std::index_sequence<Index...>) {
+    (ReadColumn(stmt, first_column + static_cast<int>(Index),
+                row.*std::get<Index>(columns)),
+     ...);
+}
+
+// Reads the current row into 'row', starting at 'first_column'.
+template <typename Struct, typename... Fields>
+void ReadRow(sqlite3_stmt *stmt, Struct &row,
+             const std::tuple<Fields Struct::*...> &columns,
+             int first_column = 0) {
+    ReadRowImpl(stmt, first_column, row, columns,
+                std::index_sequence_for<Fields...>{});
+}
+
+// Steps through all rows. Returns false if stepping ended with an error.
+template <typename Struct, typename... Fields>
+bool ReadAll(sqlite3_stmt *stmt,
+             const std::tuple<Fields Struct::*...> &columns,
+             std::vector<Struct> &rows) {
+    int rc;
+    while ((rc = sqlite3_step(stmt)) == SQLITE_ROW) {
+        rows.emplace_back();
+        ReadRow(stmt, rows.back(), columns);
+    }
+    return rc == SQLITE_DONE;
+}
+
+} // namespace RowMapper
@@ -9,4 +9,11 @@ struct Settings {
     std::string period_end_date;
     std::string note;
     int import_preview_lines;
+    int import_batch_size; // Строк в одной транзакции импорта
+    // Параметры соединения SQLite
+    int db_cache_size_kb;
+    int db_mmap_size_mb;
+    int db_busy_timeout_ms;
+    // Держать столбцовый снимок платежей для итогов (PaymentColumns)
+    bool payment_snapshot;
 };
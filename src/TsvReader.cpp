@@ -0,0 +1,157 @@
+#include "TsvReader.h"
+
+#include <fcntl.h>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+TsvReader::TsvReader() {}
+
+TsvReader::~TsvReader() { Close(); }
+
+bool TsvReader::Open(const std::string &filepath) {
+    Close();
+
+    int fd = ::open(filepath.c_str(), O_RDONLY);
+    if (fd < 0) {
+        std::cerr << "Cannot open TSV file: " << filepath << std::endl;
+        return false;
+    }
+    struct stat st;
+    if (fstat(fd, &st) != 0) {
+        ::close(fd);
+        std::cerr << "Cannot stat TSV file: " << filepath << std::endl;
+        return false;
+    }
+
+    size = static_cast<size_t>(st.st_size);
+    if (size > 0) {
+        void *mapping = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (mapping != MAP_FAILED) {
+            madvise(mapping, size, MADV_SEQUENTIAL);
+            data = static_cast<const char *>(mapping);
+            mapped = true;
+        }
+    }
+    ::close(fd);
+
+    // Файлы, которые нельзя отобразить в память (каналы и т.п.), читаются
+    // целиком в буфер
+    if (size > 0 && !mapped) {
+        std::ifstream file(filepath, std::ios::binary);
+        fallbackBuffer.assign(std::istreambuf_iterator<char>(file),
+                              std::istreambuf_iterator<char>());
+        data = fallbackBuffer.data();
+        size = fallbackBuffer.size();
+    }
+
+    pos = 0;
+    opened = true;
+    return true;
+}
+
+void TsvReader::Close() {
+    if (mapped) {
+        munmap(const_cast<char *>(data), size);
+    }
+    data = nullptr;
+    size = 0;
+    pos = 0;
+    opened = false;
+    mapped = false;
+    fallbackBuffer.clear();
+    unescapedFields.clear();
+}
+
+// Поле в кавычках: pos указывает на открывающую кавычку. Если за
+// закрывающей кавычкой сразу не идёт конец поля (как в 1С-выгрузках вида
+// "ООО "Ромашка" ..." без экранирования) или её нет вовсе, поле читается как
+// обычное, до табуляции или конца строки.
+std::string_view TsvReader::ReadQuotedField() {
+    const size_t start = pos;
+    size_t i = pos + 1;
+    bool has_escapes = false;
+    size_t close = std::string::npos;
+    while (i < size) {
+        if (data[i] == '"') {
+            if (i + 1 < size && data[i + 1] == '"') {
+                has_escapes = true;
+                i += 2;
+                continue;
+            }
+            close = i;
+            break;
+        }
+        ++i;
+    }
+
+    if (close != std::string::npos) {
+        size_t after = close + 1;
+        if (after < size && data[after] == '\r' &&
+            (after + 1 == size || data[after + 1] == '\n')) {
+            ++after;
+        }
+        if (after == size || data[after] == '\t' || data[after] == '\n') {
+            pos = after;
+            if (!has_escapes) {
+                return std::string_view(data + start + 1, close - start - 1);
+            }
+            std::string &field = unescapedFields.emplace_back();
+            field.reserve(close - start);
+            for (size_t k = start + 1; k < close; ++k) {
+                field += data[k];
+                if (data[k] == '"') {
+                    ++k; // Вторая кавычка пары ""
+                }
+            }
+            return field;
+        }
+    }
+
+    pos = start;
+    return ReadPlainField();
+}
+
+std::string_view TsvReader::ReadPlainField() {
+    const size_t start = pos;
+    while (pos < size && data[pos] != '\t' && data[pos] != '\n') {
+        ++pos;
+    }
+    size_t end = pos;
+    if (end > start && data[end - 1] == '\r' &&
+        (end == size || data[end] == '\n')) {
+        --end; // CRLF
+    }
+    return std::string_view(data + start, end - start);
+}
+
+bool TsvReader::NextRow(std::vector<std::string_view> &fields) {
+    fields.clear();
+    unescapedFields.clear();
+    if (pos >= size) {
+        return false;
+    }
+
+    while (true) {
+        fields.push_back(data[pos] == '"' ? ReadQuotedField()
+                                          : ReadPlainField());
+
+        if (pos >= size) {
+            break;
+        }
+        if (data[pos] == '\t') {
+            ++pos;
+            if (pos >= size) {
+                fields.push_back(std::string_view());
+                break;
+            }
+            continue;
+        }
+        ++pos; // '\n'
+        break;
+    }
+    return true;
+}
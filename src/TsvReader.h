@@ -0,0 +1,48 @@
+#pragma once
+
+#include <cstddef>
+#include <deque>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// Однопроходное чтение TSV-файла, отображённого в память. Поля возвращаются
+// как string_view на данные файла, без копирования. Поддерживаются поля в
+// кавычках (с табуляциями, переводами строк и "" внутри) и окончания строк
+// CRLF.
+class TsvReader {
+public:
+    TsvReader();
+    ~TsvReader();
+    TsvReader(const TsvReader&) = delete;
+    TsvReader& operator=(const TsvReader&) = delete;
+
+    bool Open(const std::string& filepath);
+    void Close();
+    bool IsOpen() const { return opened; }
+
+    // Reads the next record into 'fields'. Views stay valid until the next
+    // call to NextRow() or Close(). Returns false at end of file.
+    bool NextRow(std::vector<std::string_view>& fields);
+
+    // Byte position of the next unread record and the file size, for
+    // progress reporting.
+    size_t Offset() const { return pos; }
+    size_t Size() const { return size; }
+    // Whole file contents (valid while the file is open).
+    std::string_view Contents() const { return std::string_view(data, size); }
+
+private:
+    std::string_view ReadQuotedField();
+    std::string_view ReadPlainField();
+
+    const char* data = nullptr;
+    size_t size = 0;
+    size_t pos = 0;
+    bool opened = false;
+    bool mapped = false;
+    std::string fallbackBuffer; // Если mmap недоступен
+
+    // Поля, которые пришлось собрать заново (с "" внутри кавычек)
+    std::deque<std::string> unescapedFields;
+};
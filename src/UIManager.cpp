@@ -1,4 +1,5 @@
 #include "UIManager.h"
+#include <cstdio>
 #include <iostream>
 #include <string>
 #include <fstream>
@@ -18,9 +19,24 @@ UIManager::UIManager()
     : dbManager(nullptr), pdfReporter(nullptr), importManager(nullptr), window(nullptr), activeView(nullptr) {
     LoadRecentDbPaths();
     importMapView.SetUIManager(this);
+    paymentsView.SetReferenceCache(&referenceCache);
+    contractsView.SetReferenceCache(&referenceCache);
+    invoicesView.SetReferenceCache(&referenceCache);
+    paymentsView.SetDataLoader(&dataLoader);
+    kosguView.SetDataLoader(&dataLoader);
+    counterpartiesView.SetDataLoader(&dataLoader);
+    contractsView.SetDataLoader(&dataLoader);
+    invoicesView.SetDataLoader(&dataLoader);
+    paymentSnapshot.SetDataLoader(&dataLoader);
+    referenceCache.SetDataLoader(&dataLoader);
+    kosguView.SetPaymentSnapshot(&paymentSnapshot);
+    counterpartiesView.SetPaymentSnapshot(&paymentSnapshot);
+    contractsView.SetPaymentSnapshot(&paymentSnapshot);
+    invoicesView.SetPaymentSnapshot(&paymentSnapshot);
 }
 
 UIManager::~UIManager() {
+    CancelImport();
     SaveRecentDbPaths();
 }
 
@@ -60,6 +76,9 @@ void UIManager::SaveRecentDbPaths() {
 
 void UIManager::SetDatabaseManager(DatabaseManager* manager) {
     dbManager = manager;
+    referenceCache.SetDatabaseManager(manager);
+    dataLoader.SetDatabaseManager(manager);
+    paymentSnapshot.SetDatabaseManager(manager);
     paymentsView.SetDatabaseManager(manager);
     kosguView.SetDatabaseManager(manager);
     counterpartiesView.SetDatabaseManager(manager);
@@ -93,6 +112,11 @@ void UIManager::SetActiveView(BaseView* view) {
     activeView = view;
 }
 
+void UIManager::CancelImport() {
+    importJob.Cancel();
+    importJob.Wait();
+}
+
 void UIManager::SetWindowTitle(const std::string& db_path) {
     std::string title = "Financial Audit Application";
     if (!db_path.empty()) {
@@ -105,6 +129,7 @@ void UIManager::HandleFileDialogs() {
     if (ImGuiFileDialog::Instance()->Display("ChooseDbFileDlgKey")) {
         if (ImGuiFileDialog::Instance()->IsOk()) {
             std::string filePathName = ImGuiFileDialog::Instance()->GetFilePathName();
+            CancelImport();
             if (dbManager->createDatabase(filePathName)) {
                 currentDbPath = filePathName;
                 SetWindowTitle(currentDbPath);
@@ -117,6 +142,7 @@ void UIManager::HandleFileDialogs() {
     if (ImGuiFileDialog::Instance()->Display("OpenDbFileDlgKey")) {
         if (ImGuiFileDialog::Instance()->IsOk()) {
             std::string filePathName = ImGuiFileDialog::Instance()->GetFilePathName();
+            CancelImport();
             if (dbManager->open(filePathName)) {
                 currentDbPath = filePathName;
                 SetWindowTitle(currentDbPath);
@@ -151,7 +177,31 @@ void UIManager::HandleFileDialogs() {
 }
 
 
+void UIManager::DispatchDatabaseChanges() {
+    if (!dbManager) {
+        return;
+    }
+    dbManager->getChangeBus().Take(databaseChanges);
+    if (databaseChanges.Empty()) {
+        return;
+    }
+    BaseView* views[] = {&paymentsView, &kosguView, &counterpartiesView, &contractsView, &invoicesView,
+                         &sqlQueryView, &settingsView, &importMapView, &regexesView};
+    for (const auto& change : databaseChanges.Changes()) {
+        paymentSnapshot.OnDatabaseChanged(change);
+        for (BaseView* view : views) {
+            view->OnDatabaseChanged(change);
+        }
+    }
+}
+
 void UIManager::Render() {
+    referenceCache.BeginFrame();
+    // Сначала загруженные списки, затем изменения поверх них
+    dataLoader.Deliver();
+    DispatchDatabaseChanges();
+    paymentSnapshot.Update();
+
     if(paymentsView.IsVisible) activeView = &paymentsView;
     if(kosguView.IsVisible) activeView = &kosguView;
     if(counterpartiesView.IsVisible) activeView = &counterpartiesView;
@@ -171,18 +221,65 @@ void UIManager::Render() {
     importMapView.Render();
     regexesView.Render();
 
-    if (isImporting) {
+    RenderImportProgress();
+}
+
+// Время в виде м:сс или ч:мм:сс
+static std::string format_duration(double seconds) {
+    long long total = static_cast<long long>(seconds + 0.5);
+    char buf[32];
+    if (total >= 3600) {
+        snprintf(buf, sizeof(buf), "%lld:%02lld:%02lld", total / 3600,
+                 total / 60 % 60, total % 60);
+    } else {
+        snprintf(buf, sizeof(buf), "%lld:%02lld", total / 60, total % 60);
+    }
+    return buf;
+}
+
+void UIManager::RenderImportProgress() {
+    if (importJob.IsRunning()) {
         ImGui::OpenPopup("Importing...");
     }
 
     if (ImGui::BeginPopupModal("Importing...", NULL, ImGuiWindowFlags_AlwaysAutoResize)) {
-        {
-            std::lock_guard<std::mutex> lock(importMutex);
-            ImGui::Text("%s", importMessage.c_str());
+        const ImportProgress& progress = importJob.Progress();
+        const bool running = importJob.IsRunning();
+        ImGui::Text("%s", importJob.GetTitle().c_str());
+        // Пока задание идёт, строка собирается здесь из счётчиков; итог
+        // задание пишет само
+        if (running) {
+            ImGui::Text("Скорость: %s", progress.StageSummary("обработка").c_str());
+        } else {
+            ImGui::Text("%s", progress.message.c_str());
+        }
+        const float fraction = progress.Fraction();
+        char overlay[32];
+        snprintf(overlay, sizeof(overlay), "%d%%", static_cast<int>(fraction * 100));
+        ImGui::ProgressBar(fraction, ImVec2(400, 0), overlay);
+
+        ImGui::Text("Прочитано %zu (%zu КБ), разобрано %zu, обработано %zu строк, ошибок %zu",
+                    progress.rows_read.load(), progress.bytes_read.load() / 1024,
+                    progress.rows_parsed.load(), progress.rows_written.load(),
+                    progress.rows_failed.load());
+        std::string timing = "Прошло " + format_duration(importJob.ElapsedSeconds()) + ", " +
+                             std::to_string(static_cast<long long>(importJob.RowsPerSecond())) + " строк/с";
+        const double eta = importJob.EtaSeconds();
+        if (running) {
+            timing += eta >= 0.0 ? ", осталось ~" + format_duration(eta) : ", оценка времени...";
         }
-        ImGui::ProgressBar(importProgress, ImVec2(200, 0));
+        ImGui::Text("%s", timing.c_str());
 
-        if (!isImporting) {
+        if (running) {
+            // Отмена откатывает только текущую пачку строк
+            const bool cancelling = importJob.IsCancelRequested();
+            ImGui::BeginDisabled(cancelling);
+            if (ImGui::Button(cancelling ? "Отмена..." : "Отмена")) {
+                importJob.Cancel();
+            }
+            ImGui::EndDisabled();
+        } else if (ImGui::Button("Закрыть")) {
+            // После завершения оставляем итог импорта на экране до закрытия
             ImGui::CloseCurrentPopup();
         }
         ImGui::EndPopup();
@@ -3,10 +3,12 @@
 #include "imgui.h"
 #include <vector>
 #include <string>
-#include <atomic>
-#include <mutex>
 #include "Kosgu.h"
 #include "DatabaseManager.h"
+#include "DataLoader.h"
+#include "ImportJob.h"
+#include "PaymentColumns.h"
+#include "ReferenceCache.h"
 #include "PdfReporter.h"
 #include "views/BaseView.h"
 #include "views/PaymentsView.h"
@@ -35,15 +37,13 @@ public:
     void HandleFileDialogs();
     void SetWindowTitle(const std::string& db_path);
     void SetActiveView(BaseView* view);
+    // Stops a running import and waits for it; the import writes through
+    // the database connection, so call this before closing or switching it.
+    void CancelImport();
 
     std::vector<std::string> recentDbPaths;
     std::string currentDbPath;
 
-    std::atomic<bool> isImporting{false};
-    std::atomic<float> importProgress{0.0f};
-    std::string importMessage;
-    std::mutex importMutex;
-
     PaymentsView paymentsView;
     KosguView kosguView;
     CounterpartiesView counterpartiesView;
@@ -55,12 +55,22 @@ public:
     RegexesView regexesView;
     ImportManager* importManager;
     BaseView* activeView = nullptr;
+    ReferenceCache referenceCache;
+    DataLoader dataLoader;
+    PaymentSnapshot paymentSnapshot;
+    // Объявлено после окон: задание может писать в них и должно быть
+    // остановлено раньше
+    ImportJob importJob;
 
 private:
     void LoadRecentDbPaths();
     void SaveRecentDbPaths();
+    void RenderImportProgress();
+    // Раздаёт окнам изменения, зафиксированные с прошлого кадра
+    void DispatchDatabaseChanges();
 
     DatabaseManager* dbManager;
+    DbChangeSet databaseChanges; // Буфер DispatchDatabaseChanges
     PdfReporter* pdfReporter;
     GLFWwindow* window;
 };
@@ -0,0 +1,49 @@
+#include "Utf8.h"
+
+namespace Utf8 {
+
+std::string FoldCase(const std::string &text) {
+    std::string result;
+    result.reserve(text.size());
+    const size_t size = text.size();
+    for (size_t i = 0; i < size; ++i) {
+        unsigned char c = static_cast<unsigned char>(text[i]);
+        if (c < 0x80) {
+            result += (c >= 'A' && c <= 'Z') ? static_cast<char>(c + 32)
+                                             : static_cast<char>(c);
+            continue;
+        }
+        if (i + 1 >= size) {
+            result += static_cast<char>(c);
+            continue;
+        }
+        unsigned char next = static_cast<unsigned char>(text[i + 1]);
+        if (c == 0xD0 && next >= 0x80 && next <= 0xAF) {
+            if (next <= 0x8F) {
+                // U+0400-U+040F (Ѐ, Ё, Ђ...) -> U+0450-U+045F
+                result += static_cast<char>(0xD1);
+                result += static_cast<char>(next + 0x10);
+            } else if (next <= 0x9F) {
+                // А-П -> а-п
+                result += static_cast<char>(0xD0);
+                result += static_cast<char>(next + 0x20);
+            } else {
+                // Р-Я -> р-я
+                result += static_cast<char>(0xD1);
+                result += static_cast<char>(next - 0x20);
+            }
+            ++i;
+        } else if (c == 0xC3 && next >= 0x80 && next <= 0x9E &&
+                   next != 0x97) {
+            // Latin-1: À-Þ (кроме ×) -> à-þ
+            result += static_cast<char>(0xC3);
+            result += static_cast<char>(next + 0x20);
+            ++i;
+        } else {
+            result += static_cast<char>(c);
+        }
+    }
+    return result;
+}
+
+} // namespace Utf8
@@ -0,0 +1,9 @@
+#pragma once
+#include <string>
+
+namespace Utf8 {
+// Приводит UTF-8 строку к нижнему регистру для поиска без учёта регистра.
+// Обрабатываются ASCII, Latin-1 и кириллица (включая Ё и буквы U+0400-U+040F);
+// остальные символы и некорректные последовательности копируются как есть.
+std::string FoldCase(const std::string &text);
+}
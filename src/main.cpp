@@ -105,6 +105,7 @@ int main(int, char**) {
                 if (ImGui::BeginMenu(ICON_FA_CLOCK_ROTATE_LEFT " Недавние файлы")) {
                     for (const auto& path : uiManager.recentDbPaths) {
                         if (ImGui::MenuItem(path.c_str())) {
+                            uiManager.CancelImport();
                             if (dbManager.open(path)) {
                                 uiManager.currentDbPath = path;
                                 uiManager.SetWindowTitle(uiManager.currentDbPath);
@@ -142,6 +143,20 @@ int main(int, char**) {
                 if (ImGui::MenuItem(ICON_FA_TABLE_CELLS " Импорт из TSV")) {
                     ImGuiFileDialog::Instance()->OpenDialog("ImportTsvFileDlgKey", "Выберите TSV файл для импорта", ".tsv");
                 }
+                if (ImGui::BeginMenu(ICON_FA_ROTATE_RIGHT " Продолжить импорт", dbManager.is_open())) {
+                    auto checkpoints = dbManager.getImportCheckpoints();
+                    if (checkpoints.empty()) {
+                        ImGui::MenuItem("Нет прерванных импортов", nullptr, false, false);
+                    }
+                    for (const auto& checkpoint : checkpoints) {
+                        std::string label = checkpoint.file_path + " (" + std::to_string(checkpoint.rows_committed) +
+                                            " строк, " + checkpoint.updated_at + ")";
+                        if (ImGui::MenuItem(label.c_str())) {
+                            uiManager.importMapView.Open(checkpoint.file_path);
+                        }
+                    }
+                    ImGui::EndMenu();
+                }
                 ImGui::EndMenu();
             }
             if (ImGui::BeginMenu(ICON_FA_FILE_PDF " Отчеты")) {
@@ -186,6 +201,9 @@ int main(int, char**) {
     }
 
     // --- Очистка ресурсов ---
+    // Импорт пишет через соединение dbManager, который удаляется раньше
+    // uiManager
+    uiManager.CancelImport();
     ImGui_ImplOpenGL3_Shutdown();
     ImGui_ImplGlfw_Shutdown();
     ImGui::DestroyContext();
@@ -1,12 +1,18 @@
 #pragma once
 
 #include "imgui.h"
+#include "../DataLoader.h"
 #include "../DatabaseManager.h"
 #include "../PdfReporter.h"
+#include <algorithm>
+#include <unordered_map>
 #include <vector>
 #include <string>
 #include <utility>
 
+class PaymentSnapshot;
+class ReferenceCache;
+
 class BaseView {
 public:
     virtual ~BaseView() = default;
@@ -15,11 +21,249 @@ public:
     virtual void SetPdfReporter(PdfReporter* pdfReporter) = 0;
     virtual std::pair<std::vector<std::string>, std::vector<std::vector<std::string>>> GetDataAsStrings() = 0;
     virtual const char* GetTitle() = 0;
+    void SetReferenceCache(ReferenceCache* cache) { references = cache; }
+    void SetDataLoader(DataLoader* dataLoader) { loader = dataLoader; }
+    void SetPaymentSnapshot(PaymentSnapshot* snapshot) { paymentSnapshot = snapshot; }
+    // Called on the UI thread for every committed change (see ChangeBus).
+    virtual void OnDatabaseChanged(const DbChange&) {}
 
     bool IsVisible = false;
     std::string Title;
 
 protected:
+    // Позиции строк большого списка по id, чтобы каждое изменение из
+    // ChangeBus не искало свою строку перебором. Строится при первом поиске
+    // и заново, если список заменили (другой буфер или размер) или
+    // пересортировали (по позиции из индекса стоит строка с другим id).
+    class RowIdIndex {
+    public:
+        // Position of the entry with this id, -1 if none.
+        template <typename Entry>
+        int Find(const std::vector<Entry>& rows, int id) {
+            if (static_cast<const void*>(rows.data()) != data || rows.size() != size) {
+                Rebuild(rows);
+            }
+            auto it = positions.find(id);
+            if (it != positions.end() && rows[it->second].id != id) {
+                Rebuild(rows);
+                it = positions.find(id);
+            }
+            return it == positions.end() ? -1 : it->second;
+        }
+
+        template <typename Entry>
+        void Append(std::vector<Entry>& rows, Entry entry) {
+            Find(rows, entry.id);
+            positions[entry.id] = static_cast<int>(rows.size());
+            rows.push_back(std::move(entry));
+            Remember(rows);
+        }
+
+        // Removes rows[position] by moving the last row into its place; the
+        // list is expected to be re-sorted afterwards.
+        template <typename Entry>
+        void Remove(std::vector<Entry>& rows, int position) {
+            Find(rows, rows[position].id);
+            positions.erase(rows[position].id);
+            if (position + 1 != static_cast<int>(rows.size())) {
+                rows[position] = std::move(rows.back());
+                positions[rows[position].id] = position;
+            }
+            rows.pop_back();
+            Remember(rows);
+        }
+
+    private:
+        template <typename Entry>
+        void Rebuild(const std::vector<Entry>& rows) {
+            positions.clear();
+            positions.reserve(rows.size());
+            for (size_t i = 0; i < rows.size(); ++i) {
+                positions[rows[i].id] = static_cast<int>(i);
+            }
+            Remember(rows);
+        }
+
+        template <typename Entry>
+        void Remember(const std::vector<Entry>& rows) {
+            data = rows.data();
+            size = rows.size();
+        }
+
+        std::unordered_map<int, int> positions;
+        const void* data = nullptr;
+        size_t size = 0;
+    };
+
+    // Строки платежей выбранной записи справочника под её редактором.
+    // Читаются через DataLoader (владелец - сама панель), поэтому ни выбор
+    // записи, ни каждая порция импорта не останавливают интерфейс.
+    class PaymentInfoPane {
+    public:
+        using Read = std::vector<ContractPaymentInfo> (DatabaseManager::*)(int);
+
+        explicit PaymentInfoPane(Read read) : read(read) {}
+
+        // Starts reading the rows of entry 'id'. Rows of the same entry stay
+        // visible until the new ones arrive; another entry starts empty.
+        void Load(DataLoader& loader, int id) {
+            if (id != entryId) {
+                rows.clear();
+            }
+            entryId = id;
+            stale = false;
+            const Read query = read;
+            loader.Load<std::vector<ContractPaymentInfo>>(
+                this, [query, id](DatabaseManager& db) { return (db.*query)(id); },
+                [this](std::vector<ContractPaymentInfo>& result) { rows = std::move(result); });
+        }
+
+        // Marks the rows stale when payments or their details changed.
+        void OnDatabaseChanged(const DbChange& change) {
+            if (change.table == DbTable::Payments || change.table == DbTable::PaymentDetails) {
+                stale = true;
+            }
+        }
+
+        // Once per frame while the rows are shown: reads them again after a
+        // change, when the running read (if any) is done, so a burst of
+        // changes costs one read. True while a read is running.
+        bool Update(DataLoader& loader) {
+            if (stale && entryId != -1 && !loader.IsLoading(this)) {
+                Load(loader, entryId);
+            }
+            return loader.IsLoading(this);
+        }
+
+        const std::vector<ContractPaymentInfo>& Rows() const { return rows; }
+
+    private:
+        Read read;
+        std::vector<ContractPaymentInfo> rows;
+        int entryId = -1; // Запись, чьи строки показаны или читаются
+        bool stale = false; // Изменения после начала последнего чтения
+    };
+
+    // Applies an Insert/Update/Delete of one row to a cached list of
+    // entries with an 'id' field. 'load(id, entry)' reads the current row;
+    // the entry is dropped if it can no longer be read. Returns true if
+    // 'rows' changed.
+    template <typename Entry, typename Loader>
+    static bool ApplyRowChange(std::vector<Entry>& rows, const DbChange& change, Loader load) {
+        const int id = static_cast<int>(change.id);
+        auto it = std::find_if(rows.begin(), rows.end(), [id](const Entry& entry) { return entry.id == id; });
+        Entry entry;
+        if (change.kind != DbChangeKind::Delete && load(id, entry)) {
+            if (it != rows.end()) {
+                *it = std::move(entry);
+            } else {
+                rows.push_back(std::move(entry));
+            }
+            return true;
+        }
+        if (it != rows.end()) {
+            rows.erase(it);
+            return true;
+        }
+        return false;
+    }
+
+    // The same for a list that is sorted again after every change: the row
+    // is found through 'index' and a removed row is replaced by the last.
+    template <typename Entry, typename Loader>
+    static bool ApplyRowChange(std::vector<Entry>& rows, RowIdIndex& index, const DbChange& change, Loader load) {
+        const int id = static_cast<int>(change.id);
+        const int position = index.Find(rows, id);
+        Entry entry;
+        if (change.kind != DbChangeKind::Delete && load(id, entry)) {
+            if (position != -1) {
+                rows[position] = std::move(entry);
+            } else {
+                index.Append(rows, std::move(entry));
+            }
+            return true;
+        }
+        if (position != -1) {
+            index.Remove(rows, position);
+            return true;
+        }
+        return false;
+    }
+
+    // Keeps a dictionary list in step with committed changes of its own
+    // table. A Reload, or any change while a load is running (it may have
+    // read the table before the change), reads the list again through
+    // 'refresh'; a hidden window drops the list instead and reads it when it
+    // is opened. Other changes go through ApplyRowChange with 'fetch(id,
+    // entry)', and 'selectedIndex' follows the row of 'selectedId' so the
+    // editor buffer keeps its edits. Returns true if 'rows' changed in place
+    // and must be sorted again.
+    template <typename Entry, typename Fetch, typename Refresh>
+    bool ApplyDictionaryChange(const DbChange& change, std::vector<Entry>& rows, RowIdIndex& index,
+                               int selectedId, int& selectedIndex, bool& loaded, Fetch fetch,
+                               Refresh refresh) {
+        if (change.kind == DbChangeKind::Reload || loader->IsLoading(this)) {
+            if (IsVisible || loader->IsLoading(this)) {
+                refresh();
+            } else {
+                rows.clear();
+                selectedIndex = -1;
+                loaded = false;
+            }
+            return false;
+        }
+        if (!loaded || !ApplyRowChange(rows, index, change, fetch)) {
+            return false;
+        }
+        if (selectedIndex != -1) {
+            selectedIndex = index.Find(rows, selectedId);
+        }
+        return true;
+    }
+
+    // Remembers why a delete failed, or clears the message after a
+    // successful one. 'referenced_by' names the rows that may still refer
+    // to the entry.
+    void ReportDeleteResult(bool deleted, const char* referenced_by) {
+        if (deleted) {
+            deleteError.clear();
+        } else if (dbManager && dbManager->isForeignKeyViolation()) {
+            deleteError = std::string("Запись нельзя удалить: на неё ссылаются ") + referenced_by + ".";
+        } else {
+            deleteError = "Не удалось удалить запись.";
+        }
+    }
+
+    // Message of the last failed delete, under the toolbar.
+    void RenderDeleteError() {
+        if (deleteError.empty()) {
+            return;
+        }
+        ImGui::PushStyleColor(ImGuiCol_Text, ImVec4(0.9f, 0.3f, 0.3f, 1.0f));
+        ImGui::TextWrapped("%s", deleteError.c_str());
+        ImGui::PopStyleColor();
+    }
+
+    // Position of the entry with this id, -1 if none.
+    template <typename Entry>
+    static int IndexOfId(const std::vector<Entry>& rows, int id) {
+        for (size_t i = 0; i < rows.size(); ++i) {
+            if (rows[i].id == id) {
+                return static_cast<int>(i);
+            }
+        }
+        return -1;
+    }
+
     DatabaseManager* dbManager = nullptr;
     PdfReporter* pdfReporter = nullptr;
+    // Общие справочники для подписей и выпадающих списков (UIManager)
+    ReferenceCache* references = nullptr;
+    // Внешние ключи включены, поэтому удаление используемой записи
+    // отклоняется базой
+    std::string deleteError;
+    // Фоновая загрузка списков (UIManager)
+    DataLoader* loader = nullptr;
+    // Столбцовый снимок платежей для итогов (UIManager)
+    PaymentSnapshot* paymentSnapshot = nullptr;
 };
@@ -1,7 +1,11 @@
 #include "ContractsView.h"
 #include <iostream>
 #include <cstring>
+#include "../CustomWidgets.h"
+#include "../DataLoader.h"
 #include "../IconsFontAwesome6.h"
+#include "../PaymentColumns.h"
+#include "../ReferenceCache.h"
 #include <algorithm>
 
 ContractsView::ContractsView()
@@ -18,15 +22,31 @@ void ContractsView::SetPdfReporter(PdfReporter* reporter) {
 }
 
 void ContractsView::RefreshData() {
-    if (dbManager) {
-        contracts = dbManager->getContracts();
-        selectedContractIndex = -1;
+    if (!dbManager || !loader) {
+        return;
     }
+    loader->Load<std::vector<Contract>>(
+        this, [](DatabaseManager& db) { return db.getContracts(); },
+        [this](std::vector<Contract>& entries) {
+            contracts = std::move(entries);
+            if (selectedContractIndex != -1) {
+                selectedContractIndex = contractPositions.Find(contracts, selectedContract.id);
+            }
+            loaded = true;
+            sortDirty = true;
+        });
 }
 
-void ContractsView::RefreshDropdownData() {
-    if (dbManager) {
-        counterpartiesForDropdown = dbManager->getCounterparties();
+void ContractsView::OnDatabaseChanged(const DbChange& change) {
+    payment_info.OnDatabaseChanged(change);
+    if (change.table != DbTable::Contracts || !dbManager || !loader) {
+        return;
+    }
+    if (ApplyDictionaryChange(
+            change, contracts, contractPositions, selectedContract.id, selectedContractIndex, loaded,
+            [this](int id, Contract& entry) { return dbManager->getContractById(id, entry); },
+            [this]() { RefreshData(); })) {
+        sortDirty = true;
     }
 }
 
@@ -35,19 +55,10 @@ const char* ContractsView::GetTitle() {
 }
 
 std::pair<std::vector<std::string>, std::vector<std::vector<std::string>>> ContractsView::GetDataAsStrings() {
-    auto getCounterpartyName = [&](int id) -> std::string {
-        for (const auto& cp : counterpartiesForDropdown) {
-            if (cp.id == id) {
-                return cp.name;
-            }
-        }
-        return "N/A";
-    };
-
     std::vector<std::string> headers = {"ID", "Номер", "Дата", "Контрагент"};
     std::vector<std::vector<std::string>> rows;
     for (const auto& entry : contracts) {
-        rows.push_back({std::to_string(entry.id), entry.number, entry.date, getCounterpartyName(entry.counterparty_id)});
+        rows.push_back({std::to_string(entry.id), entry.number, entry.date, references->CounterpartyName(entry.counterparty_id)});
     }
     return {headers, rows};
 }
@@ -84,9 +95,9 @@ void ContractsView::Render() {
         return;
     }
 
-    if (dbManager && contracts.empty()) {
+    // Пустая таблица тоже загружена: не запрашивать её на каждом кадре
+    if (dbManager && !loaded && loader && !loader->IsLoading(this)) {
         RefreshData();
-        RefreshDropdownData();
     }
 
     // Панель управления
@@ -98,9 +109,12 @@ void ContractsView::Render() {
     ImGui::SameLine();
     if (ImGui::Button(ICON_FA_TRASH " Удалить")) {
         if (!isAdding && selectedContractIndex != -1 && dbManager) {
-            dbManager->deleteContract(contracts[selectedContractIndex].id);
-            RefreshData();
-            selectedContract = Contract{};
+            const bool deleted = dbManager->deleteContract(contracts[selectedContractIndex].id);
+            ReportDeleteResult(deleted, "накладные или расшифровки платежей");
+            if (deleted) {
+                selectedContractIndex = -1;
+                selectedContract = Contract{};
+            }
         }
     }
     ImGui::SameLine();
@@ -112,15 +126,19 @@ void ContractsView::Render() {
             } else if (selectedContract.id != -1) {
                 dbManager->updateContract(selectedContract);
             }
-            RefreshData();
         }
     }
     ImGui::SameLine();
     if (ImGui::Button(ICON_FA_ROTATE_RIGHT " Обновить")) {
         RefreshData();
-        RefreshDropdownData();
+        references->Invalidate();
+    }
+    if ((loader && loader->IsLoading(this)) || references->IsLoading()) {
+        ImGui::SameLine();
+        CustomWidgets::Spinner("Загрузка...");
     }
 
+    RenderDeleteError();
     ImGui::Separator();
 
     ImGui::InputText("Фильтр по номеру", filterText, sizeof(filterText));
@@ -135,20 +153,15 @@ void ContractsView::Render() {
         ImGui::TableHeadersRow();
 
         if (ImGuiTableSortSpecs* sort_specs = ImGui::TableGetSortSpecs()) {
-            if (sort_specs->SpecsDirty) {
+            if (sort_specs->SpecsDirty || sortDirty) {
                 SortContracts(contracts, sort_specs);
                 sort_specs->SpecsDirty = false;
-            }
-        }
-
-        auto getCounterpartyName = [&](int id) -> const char* {
-            for (const auto& cp : counterpartiesForDropdown) {
-                if (cp.id == id) {
-                    return cp.name.c_str();
+                sortDirty = false;
+                if (selectedContractIndex != -1) {
+                    selectedContractIndex = contractPositions.Find(contracts, selectedContract.id);
                 }
             }
-            return "N/A";
-        };
+        }
 
         for (int i = 0; i < contracts.size(); ++i) {
              if (filterText[0] != '\0' && strcasestr(contracts[i].number.c_str(), filterText) == nullptr) {
@@ -165,8 +178,8 @@ void ContractsView::Render() {
                 selectedContractIndex = i;
                 selectedContract = contracts[i];
                 isAdding = false;
-                if(dbManager) {
-                    payment_info = dbManager->getPaymentInfoForContract(selectedContract.id);
+                if (loader) {
+                    payment_info.Load(*loader, selectedContract.id);
                 }
             }
             if (is_selected) {
@@ -178,7 +191,7 @@ void ContractsView::Render() {
             ImGui::TableNextColumn();
             ImGui::Text("%s", contracts[i].date.c_str());
             ImGui::TableNextColumn();
-            ImGui::Text("%s", getCounterpartyName(contracts[i].counterparty_id));
+            ImGui::Text("%s", references->CounterpartyName(contracts[i].counterparty_id));
         }
         ImGui::EndTable();
     }
@@ -214,28 +227,13 @@ void ContractsView::Render() {
             selectedContract.date = dateBuf;
         }
         
-        if (!counterpartiesForDropdown.empty()) {
-            auto getCounterpartyName = [&](int id) -> const char* {
-                for (const auto& cp : counterpartiesForDropdown) {
-                    if (cp.id == id) {
-                        return cp.name.c_str();
-                    }
-                }
-                return "N/A";
-            };
-            const char* currentCounterpartyName = getCounterpartyName(selectedContract.counterparty_id);
+        const auto& counterparties = references->Counterparties();
+        if (!counterparties.Entries().empty()) {
+            const char* currentCounterpartyName = references->CounterpartyName(selectedContract.counterparty_id);
             
-            if (ImGui::BeginCombo("Контрагент", currentCounterpartyName)) {
-                for (const auto& cp : counterpartiesForDropdown) {
-                    bool isSelected = (cp.id == selectedContract.counterparty_id);
-                    if (ImGui::Selectable(cp.name.c_str(), isSelected)) {
-                        selectedContract.counterparty_id = cp.id;
-                    }
-                    if (isSelected) {
-                        ImGui::SetItemDefaultFocus();
-                    }
-                }
-                ImGui::EndCombo();
+            int position = counterparties.IndexOf(selectedContract.counterparty_id);
+            if (CustomWidgets::SearchableCombo("Контрагент", currentCounterpartyName, counterparties.Labels(), position)) {
+                selectedContract.counterparty_id = counterparties.Entries()[position].id;
             }
         }
         ImGui::EndChild(); 
@@ -251,6 +249,15 @@ void ContractsView::Render() {
 
         ImGui::BeginChild("PaymentDetails", ImVec2(0, 0), true);
         ImGui::Text("Расшифровки платежей:");
+        if (const PaymentColumns* columns = paymentSnapshot ? paymentSnapshot->Columns() : nullptr) {
+            const PaymentColumns::Total total = columns->SumDetails(PaymentColumns::DetailKey::Contract, selectedContract.id);
+            ImGui::SameLine();
+            ImGui::TextDisabled("итого %.2f, строк: %lld", total.kopecks / 100.0, total.rows);
+        }
+        if (loader && payment_info.Update(*loader)) {
+            ImGui::SameLine();
+            CustomWidgets::Spinner("Загрузка...");
+        }
         if (ImGui::BeginTable("payment_details_table", 4, ImGuiTableFlags_Borders | ImGuiTableFlags_RowBg | ImGuiTableFlags_Resizable | ImGuiTableFlags_ScrollX | ImGuiTableFlags_ScrollY)) {
             ImGui::TableSetupColumn("Дата");
             ImGui::TableSetupColumn("Номер док.");
@@ -258,16 +265,21 @@ void ContractsView::Render() {
             ImGui::TableSetupColumn("Назначение");
             ImGui::TableHeadersRow();
 
-            for (const auto& info : payment_info) {
-                ImGui::TableNextRow();
-                ImGui::TableNextColumn();
-                ImGui::Text("%s", info.date.c_str());
-                ImGui::TableNextColumn();
-                ImGui::Text("%s", info.doc_number.c_str());
-                ImGui::TableNextColumn();
-                ImGui::Text("%.2f", info.amount);
-                ImGui::TableNextColumn();
-                ImGui::Text("%s", info.description.c_str());
+            ImGuiListClipper clipper;
+            clipper.Begin((int)payment_info.Rows().size());
+            while (clipper.Step()) {
+                for (int row = clipper.DisplayStart; row < clipper.DisplayEnd; ++row) {
+                    const auto& info = payment_info.Rows()[row];
+                    ImGui::TableNextRow();
+                    ImGui::TableNextColumn();
+                    ImGui::Text("%s", info.date.c_str());
+                    ImGui::TableNextColumn();
+                    ImGui::Text("%s", info.doc_number.c_str());
+                    ImGui::TableNextColumn();
+                    ImGui::Text("%.2f", info.amount);
+                    ImGui::TableNextColumn();
+                    ImGui::Text("%s", info.description.c_str());
+                }
             }
             ImGui::EndTable();
         }
@@ -1,7 +1,10 @@
 #include "CounterpartiesView.h"
 #include <iostream>
 #include <cstring>
+#include "../CustomWidgets.h"
+#include "../DataLoader.h"
 #include "../IconsFontAwesome6.h"
+#include "../PaymentColumns.h"
 #include <algorithm>
 
 CounterpartiesView::CounterpartiesView()
@@ -18,9 +21,31 @@ void CounterpartiesView::SetPdfReporter(PdfReporter* reporter) {
 }
 
 void CounterpartiesView::RefreshData() {
-    if (dbManager) {
-        counterparties = dbManager->getCounterparties();
-        selectedCounterpartyIndex = -1;
+    if (!dbManager || !loader) {
+        return;
+    }
+    loader->Load<std::vector<Counterparty>>(
+        this, [](DatabaseManager& db) { return db.getCounterparties(); },
+        [this](std::vector<Counterparty>& entries) {
+            counterparties = std::move(entries);
+            if (selectedCounterpartyIndex != -1) {
+                selectedCounterpartyIndex = counterpartyPositions.Find(counterparties, selectedCounterparty.id);
+            }
+            loaded = true;
+            sortDirty = true;
+        });
+}
+
+void CounterpartiesView::OnDatabaseChanged(const DbChange& change) {
+    payment_info.OnDatabaseChanged(change);
+    if (change.table != DbTable::Counterparties || !dbManager || !loader) {
+        return;
+    }
+    if (ApplyDictionaryChange(
+            change, counterparties, counterpartyPositions, selectedCounterparty.id, selectedCounterpartyIndex, loaded,
+            [this](int id, Counterparty& entry) { return dbManager->getCounterpartyById(id, entry); },
+            [this]() { RefreshData(); })) {
+        sortDirty = true;
     }
 }
 
@@ -68,7 +93,8 @@ void CounterpartiesView::Render() {
         return;
     }
 
-    if (dbManager && counterparties.empty()) {
+    // Пустая таблица тоже загружена: не запрашивать её на каждом кадре
+    if (dbManager && !loaded && loader && !loader->IsLoading(this)) {
         RefreshData();
     }
 
@@ -81,9 +107,12 @@ void CounterpartiesView::Render() {
     ImGui::SameLine();
     if (ImGui::Button(ICON_FA_TRASH " Удалить")) {
         if (!isAdding && selectedCounterpartyIndex != -1 && dbManager) {
-            dbManager->deleteCounterparty(counterparties[selectedCounterpartyIndex].id);
-            RefreshData();
-            selectedCounterparty = Counterparty{};
+            const bool deleted = dbManager->deleteCounterparty(counterparties[selectedCounterpartyIndex].id);
+            ReportDeleteResult(deleted, "договоры или платежи");
+            if (deleted) {
+                selectedCounterpartyIndex = -1;
+                selectedCounterparty = Counterparty{};
+            }
         }
     }
     ImGui::SameLine();
@@ -95,14 +124,18 @@ void CounterpartiesView::Render() {
             } else if(selectedCounterparty.id != -1) {
                 dbManager->updateCounterparty(selectedCounterparty);
             }
-            RefreshData();
         }
     }
     ImGui::SameLine();
     if (ImGui::Button(ICON_FA_ROTATE_RIGHT " Обновить")) {
         RefreshData();
     }
+    if (loader && loader->IsLoading(this)) {
+        ImGui::SameLine();
+        CustomWidgets::Spinner("Загрузка...");
+    }
 
+    RenderDeleteError();
     ImGui::Separator();
 
     ImGui::InputText("Фильтр по имени", filterText, sizeof(filterText));
@@ -116,9 +149,13 @@ void CounterpartiesView::Render() {
         ImGui::TableHeadersRow();
 
         if (ImGuiTableSortSpecs* sort_specs = ImGui::TableGetSortSpecs()) {
-            if (sort_specs->SpecsDirty) {
+            if (sort_specs->SpecsDirty || sortDirty) {
                 SortCounterparties(counterparties, sort_specs);
                 sort_specs->SpecsDirty = false;
+                sortDirty = false;
+                if (selectedCounterpartyIndex != -1) {
+                    selectedCounterpartyIndex = counterpartyPositions.Find(counterparties, selectedCounterparty.id);
+                }
             }
         }
 
@@ -137,8 +174,8 @@ void CounterpartiesView::Render() {
                 selectedCounterpartyIndex = i;
                 selectedCounterparty = counterparties[i];
                 isAdding = false;
-                if(dbManager) {
-                    payment_info = dbManager->getPaymentInfoForCounterparty(selectedCounterparty.id);
+                if (loader) {
+                    payment_info.Load(*loader, selectedCounterparty.id);
                 }
             }
             if (is_selected) {
@@ -196,6 +233,15 @@ void CounterpartiesView::Render() {
 
         ImGui::BeginChild("PaymentDetails", ImVec2(0, 0), true);
         ImGui::Text("Расшифровки платежей:");
+        if (const PaymentColumns* columns = paymentSnapshot ? paymentSnapshot->Columns() : nullptr) {
+            const PaymentColumns::Total total = columns->SumCounterpartyDetails(selectedCounterparty.id);
+            ImGui::SameLine();
+            ImGui::TextDisabled("итого %.2f, строк: %lld", total.kopecks / 100.0, total.rows);
+        }
+        if (loader && payment_info.Update(*loader)) {
+            ImGui::SameLine();
+            CustomWidgets::Spinner("Загрузка...");
+        }
         if (ImGui::BeginTable("payment_details_table", 4, ImGuiTableFlags_Borders | ImGuiTableFlags_RowBg | ImGuiTableFlags_Resizable | ImGuiTableFlags_ScrollX | ImGuiTableFlags_ScrollY)) {
             ImGui::TableSetupColumn("Дата");
             ImGui::TableSetupColumn("Номер док.");
@@ -203,16 +249,21 @@ void CounterpartiesView::Render() {
             ImGui::TableSetupColumn("Назначение");
             ImGui::TableHeadersRow();
 
-            for (const auto& info : payment_info) {
-                ImGui::TableNextRow();
-                ImGui::TableNextColumn();
-                ImGui::Text("%s", info.date.c_str());
-                ImGui::TableNextColumn();
-                ImGui::Text("%s", info.doc_number.c_str());
-                ImGui::TableNextColumn();
-                ImGui::Text("%.2f", info.amount);
-                ImGui::TableNextColumn();
-                ImGui::Text("%s", info.description.c_str());
+            ImGuiListClipper clipper;
+            clipper.Begin((int)payment_info.Rows().size());
+            while (clipper.Step()) {
+                for (int row = clipper.DisplayStart; row < clipper.DisplayEnd; ++row) {
+                    const auto& info = payment_info.Rows()[row];
+                    ImGui::TableNextRow();
+                    ImGui::TableNextColumn();
+                    ImGui::Text("%s", info.date.c_str());
+                    ImGui::TableNextColumn();
+                    ImGui::Text("%s", info.doc_number.c_str());
+                    ImGui::TableNextColumn();
+                    ImGui::Text("%.2f", info.amount);
+                    ImGui::TableNextColumn();
+                    ImGui::Text("%s", info.description.c_str());
+                }
             }
             ImGui::EndTable();
         }
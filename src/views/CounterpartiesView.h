@@ -13,16 +13,21 @@ public:
     void SetPdfReporter(PdfReporter* pdfReporter) override;
     std::pair<std::vector<std::string>, std::vector<std::vector<std::string>>> GetDataAsStrings() override;
     const char* GetTitle() override;
+    void OnDatabaseChanged(const DbChange& change) override;
 
 private:
     void RefreshData();
 
     std::vector<Counterparty> counterparties;
+    RowIdIndex counterpartyPositions; // Позиции в counterparties по id
+    // Строки добавлены или перечитаны: отсортировать заново
+    bool sortDirty = false;
+    bool loaded = false; // Список получен от DataLoader
     Counterparty selectedCounterparty;
     int selectedCounterpartyIndex;
     bool showEditModal;
     bool isAdding;
-    std::vector<ContractPaymentInfo> payment_info;
+    PaymentInfoPane payment_info{&DatabaseManager::getPaymentInfoForCounterparty};
     char filterText[256];
     float list_view_height = 200.0f;
     float editor_width = 400.0f;
@@ -1,44 +1,32 @@
 #include "ImportMapView.h"
 #include "../IconsFontAwesome6.h"
 #include "../ImportManager.h"
+#include "../RegexMatcher.h"
+#include "../TsvReader.h"
 #include "../UIManager.h"
 #include "imgui.h"
 #include "imgui_stdlib.h"
-#include <fstream>
 #include <iostream>
-#include <regex>
-#include <sstream>
-#include <thread>
-
-// Helper to split a string by a delimiter
-static std::vector<std::string> split(const std::string &s, char delimiter) {
-    std::vector<std::string> tokens;
-    std::string token;
-    std::istringstream tokenStream(s);
-    while (std::getline(tokenStream, token, delimiter)) {
-        tokens.push_back(token);
-    }
-    return tokens;
+
+// Копирует поля строки TSV (string_view живут только до следующей строки)
+static std::vector<std::string>
+to_strings(const std::vector<std::string_view> &fields) {
+    return std::vector<std::string>(fields.begin(), fields.end());
 }
 
+// Вызывается на каждом кадре, поэтому выражение берётся из кэша, а не
+// компилируется заново
 static std::string get_regex_match(const std::string &text,
                                    const std::string &pattern) {
-    // std::cout << "Testing regex:" << std::endl;
-    // std::cout << "  Text:    '" << text << "'" << std::endl;
-    // std::cout << "  Pattern: '" << pattern << "'" << std::endl;
-    try {
-        std::regex re(pattern);
-        std::smatch match;
-        if (std::regex_search(text, match, re) && match.size() > 1) {
-            // std::cout << "  Match:   '" << match[1].str() << "'" <<
-            // std::endl;
-            return match[1].str();
-        }
-    } catch (const std::regex_error &e) {
-        // std::cerr << "  Regex error: " << e.what() << std::endl;
-        return "Regex error: " + std::string(e.what());
+    std::string error;
+    auto matcher = RegexMatcher::Get(pattern, &error);
+    if (!matcher) {
+        return "Regex error: " + error;
+    }
+    std::vector<std::string_view> groups;
+    if (matcher->Search(text, groups) && groups.size() > 1) {
+        return std::string(groups[1]);
     }
-    // std::cout << "  No match." << std::endl;
     return "No match";
 }
 
@@ -54,6 +42,9 @@ void ImportMapView::Open(const std::string &filePath) {
     importFilePath = filePath;
     ReadPreviewData();
     RefreshRegexes();
+    hasCheckpoint =
+        dbManager && dbManager->getImportCheckpoint(filePath, checkpoint);
+    resumeImport = hasCheckpoint;
     IsVisible = true;
 }
 
@@ -66,26 +57,30 @@ void ImportMapView::Reset() {
         currentMapping[field] = -1; // -1 means "Not Mapped"
     }
     sample_description.clear();
+    hasCheckpoint = false;
     contract_pattern_buffer.clear();
     kosgu_pattern_buffer.clear();
     invoice_pattern_buffer.clear();
+    std::lock_guard<std::mutex> lock(dryRunMutex);
+    dryRunStats.reset();
 }
 
 void ImportMapView::ReadPreviewData() {
     if (importFilePath.empty())
         return;
 
-    std::ifstream file(importFilePath);
-    if (!file.is_open()) {
+    // Тот же разбор, что и при импорте, чтобы столбцы совпадали
+    TsvReader reader;
+    if (!reader.Open(importFilePath)) {
         std::cerr << "ERROR: Could not open file for reading header: "
                   << importFilePath << std::endl;
         return;
     }
 
     // Read header
-    std::string headerLine;
-    if (std::getline(file, headerLine)) {
-        fileHeaders = split(headerLine, '\t');
+    std::vector<std::string_view> fields;
+    if (reader.NextRow(fields)) {
+        fileHeaders = to_strings(fields);
     }
 
     // Read first N data rows based on settings
@@ -95,10 +90,9 @@ void ImportMapView::ReadPreviewData() {
         lines_to_read = settings.import_preview_lines;
     }
 
-    std::string dataLine;
     int line_count = 0;
-    while (std::getline(file, dataLine) && line_count < lines_to_read) {
-        sampleData.push_back(split(dataLine, '\t'));
+    while (line_count < lines_to_read && reader.NextRow(fields)) {
+        sampleData.push_back(to_strings(fields));
         line_count++;
     }
 }
@@ -111,6 +105,140 @@ void ImportMapView::RefreshRegexes() {
     }
 }
 
+void ImportMapView::StartDryRun() {
+    // Пробный прогон только читает справочники, но идёт через то же
+    // отдельное соединение, что и импорт, чтобы не мешать окнам
+    DatabaseManager *writer =
+        dbManager ? dbManager->getWriterConnection() : nullptr;
+    if (!writer || !uiManager || !uiManager->importManager) {
+        return;
+    }
+    ImportManager *importer = uiManager->importManager;
+    ImportMapView *view = this;
+    uiManager->importJob.Start(
+        "Пробный прогон",
+        [importer, view, writer, filepath = importFilePath,
+         mapping = currentMapping, contract_regex = contract_pattern_buffer,
+         invoice_regex = invoice_pattern_buffer](ImportProgress &progress) {
+            auto stats = std::make_shared<ImportDryRunStats>();
+            if (!importer->DryRunPaymentsFromTsv(
+                    filepath, writer, mapping, progress, contract_regex,
+                    invoice_regex, *stats)) {
+                return false;
+            }
+            std::lock_guard<std::mutex> lock(view->dryRunMutex);
+            view->dryRunStats = stats;
+            return true;
+        });
+}
+
+// Список строк с замечаниями: номер строки данных и назначение платежа
+static void render_issue_table(const char *id,
+                               const std::vector<ImportIssue> &issues,
+                               size_t total) {
+    if (issues.empty()) {
+        ImGui::TextDisabled("Нет");
+        return;
+    }
+    if (total > issues.size()) {
+        ImGui::TextDisabled("Показаны первые %zu из %zu", issues.size(),
+                            total);
+    }
+    if (ImGui::BeginTable(id, 2,
+                          ImGuiTableFlags_Borders | ImGuiTableFlags_RowBg |
+                              ImGuiTableFlags_ScrollY)) {
+        ImGui::TableSetupScrollFreeze(0, 1);
+        ImGui::TableSetupColumn("Строка", ImGuiTableColumnFlags_WidthFixed,
+                                60.0f);
+        ImGui::TableSetupColumn("Назначение платежа");
+        ImGui::TableHeadersRow();
+        ImGuiListClipper clipper;
+        clipper.Begin(static_cast<int>(issues.size()));
+        while (clipper.Step()) {
+            for (int i = clipper.DisplayStart; i < clipper.DisplayEnd; ++i) {
+                ImGui::TableNextRow();
+                ImGui::TableNextColumn();
+                ImGui::Text("%zu", issues[i].line);
+                ImGui::TableNextColumn();
+                ImGui::TextUnformatted(issues[i].description.c_str());
+            }
+        }
+        ImGui::EndTable();
+    }
+}
+
+void ImportMapView::RenderDryRunResults(const ImportDryRunStats &stats,
+                                        float height) {
+    ImGui::Text("Результаты пробного прогона (база данных не изменялась)");
+    ImGui::BeginChild("DryRunResults", ImVec2(0, height), true);
+
+    if (ImGui::BeginTable("dry_run_rows", 2, ImGuiTableFlags_Borders)) {
+        auto row = [](const char *label, size_t value) {
+            ImGui::TableNextRow();
+            ImGui::TableNextColumn();
+            ImGui::TextUnformatted(label);
+            ImGui::TableNextColumn();
+            ImGui::Text("%zu", value);
+        };
+        row("Строк в файле", stats.rows_total);
+        row("Будет импортировано", stats.rows_to_import);
+        row("Уже загружено ранее", stats.rows_already_imported);
+        row("Пропущено (пустые, без даты и суммы)", stats.rows_skipped);
+        row("Ошибки разбора", stats.rows_parse_errors);
+        row("Нераспознанные суммы (будут 0)", stats.unparsed_amounts);
+        row("Без договора", stats.rows_without_contract);
+        row("Без накладной", stats.rows_without_invoice);
+        row("Ни договора, ни накладной", stats.unmatched_descriptions);
+        row("С расшифровкой \"в т.ч.\"", stats.rows_with_kosgu_details);
+        row("Расшифровка не сходится с суммой", stats.detail_sum_mismatches);
+        row("Будет создано расшифровок", stats.details_to_create);
+        ImGui::EndTable();
+    }
+
+    if (ImGui::BeginTable("dry_run_entities", 3, ImGuiTableFlags_Borders)) {
+        ImGui::TableSetupColumn("Справочник");
+        ImGui::TableSetupColumn("Новые");
+        ImGui::TableSetupColumn("Существующие");
+        ImGui::TableHeadersRow();
+        auto row = [](const char *label, size_t created, size_t existing) {
+            ImGui::TableNextRow();
+            ImGui::TableNextColumn();
+            ImGui::TextUnformatted(label);
+            ImGui::TableNextColumn();
+            ImGui::Text("%zu", created);
+            ImGui::TableNextColumn();
+            ImGui::Text("%zu", existing);
+        };
+        row("Контрагенты", stats.new_counterparties,
+            stats.existing_counterparties);
+        row("Договоры", stats.new_contracts, stats.existing_contracts);
+        row("Накладные", stats.new_invoices, stats.existing_invoices);
+        row("КОСГУ", stats.new_kosgu, stats.existing_kosgu);
+        ImGui::EndTable();
+    }
+
+    if (ImGui::BeginTabBar("dry_run_issues")) {
+        if (ImGui::BeginTabItem("Без договора и накладной")) {
+            render_issue_table("unmatched_rows", stats.unmatched_rows,
+                               stats.unmatched_descriptions);
+            ImGui::EndTabItem();
+        }
+        if (ImGui::BeginTabItem("Не сходится \"в т.ч.\"")) {
+            render_issue_table("mismatch_rows", stats.detail_mismatch_rows,
+                               stats.detail_sum_mismatches);
+            ImGui::EndTabItem();
+        }
+        if (ImGui::BeginTabItem("Нераспознанные суммы")) {
+            render_issue_table("amount_rows", stats.unparsed_amount_rows,
+                               stats.unparsed_amounts);
+            ImGui::EndTabItem();
+        }
+        ImGui::EndTabBar();
+    }
+
+    ImGui::EndChild();
+}
+
 void ImportMapView::Render() {
     if (!IsVisible) {
         return;
@@ -119,6 +247,16 @@ void ImportMapView::Render() {
     float footer_height =
         ImGui::GetStyle().ItemSpacing.y + ImGui::GetFrameHeightWithSpacing();
 
+    std::shared_ptr<ImportDryRunStats> dry_run;
+    {
+        std::lock_guard<std::mutex> lock(dryRunMutex);
+        if (dryRunStats && dryRunStats->filepath == importFilePath) {
+            dry_run = dryRunStats;
+        }
+    }
+    const float dry_run_height =
+        dry_run ? ImGui::GetTextLineHeightWithSpacing() * 20 : 0.0f;
+
     ImGui::SetNextWindowSize(ImVec2(700, 750), ImGuiCond_FirstUseEver);
     if (ImGui::Begin(Title.c_str(), &IsVisible)) {
         ImGui::Text("Файл: %s", importFilePath.c_str());
@@ -176,7 +314,8 @@ void ImportMapView::Render() {
 
         // --- Data Preview Table ---
         ImGui::Text("Предпросмотр данных (первые 30 строк):");
-        float bottom_part_height = ImGui::GetTextLineHeightWithSpacing() * 16;
+        float bottom_part_height =
+            ImGui::GetTextLineHeightWithSpacing() * 16 + dry_run_height;
         ImGui::BeginChild("PreviewScrollRegion",
                           ImVec2(0, -bottom_part_height), true,
                           ImGuiWindowFlags_HorizontalScrollbar);
@@ -255,22 +394,55 @@ void ImportMapView::Render() {
         render_regex_selector("Накладная", invoice_regex_index, invoice_match,
                               invoice_pattern_buffer);
 
+        if (dry_run) {
+            ImGui::Separator();
+            RenderDryRunResults(*dry_run, dry_run_height);
+        }
+
         ImGui::Separator();
+        if (hasCheckpoint) {
+            int percent =
+                checkpoint.file_size > 0
+                    ? static_cast<int>(checkpoint.byte_offset * 100 /
+                                       checkpoint.file_size)
+                    : 0;
+            ImGui::TextWrapped("Импорт этого файла был прерван: "
+                               "зафиксировано %lld строк (%d%%), %s.",
+                               checkpoint.rows_committed, percent,
+                               checkpoint.updated_at.c_str());
+            ImGui::Checkbox("Продолжить с места остановки", &resumeImport);
+        }
+        // Одновременно выполняется только одно задание импорта
+        ImGui::BeginDisabled(uiManager && uiManager->importJob.IsRunning());
         if (ImGui::Button("Импортировать")) {
-            if (dbManager && uiManager && uiManager->importManager) {
-                uiManager->isImporting = true;
-                std::thread([this]() {
-                    uiManager->importManager->ImportPaymentsFromTsv(
-                        importFilePath, dbManager, currentMapping,
-                        uiManager->importProgress, uiManager->importMessage,
-                        uiManager->importMutex, contract_pattern_buffer,
-                        kosgu_pattern_buffer, invoice_pattern_buffer);
-                    uiManager->isImporting = false;
-                }).detach();
+            DatabaseManager *writer =
+                dbManager ? dbManager->getWriterConnection() : nullptr;
+            if (writer && uiManager && uiManager->importManager) {
+                // Задание пишет через отдельное соединение и получает копии
+                // параметров: окно может быть изменено или закрыто во время
+                // импорта
+                ImportManager *importer = uiManager->importManager;
+                uiManager->importJob.Start(
+                    "Импорт " + importFilePath,
+                    [importer, writer, filepath = importFilePath,
+                     mapping = currentMapping,
+                     contract_regex = contract_pattern_buffer,
+                     invoice_regex = invoice_pattern_buffer,
+                     resume = hasCheckpoint &&
+                              resumeImport](ImportProgress &progress) {
+                        return importer->ImportPaymentsFromTsv(
+                            filepath, writer, mapping, progress,
+                            contract_regex, invoice_regex, resume);
+                    });
             }
             IsVisible = false;
         }
         ImGui::SameLine();
+        if (ImGui::Button("Пробный прогон")) {
+            StartDryRun();
+        }
+        ImGui::EndDisabled();
+        ImGui::SameLine();
         if (ImGui::Button("Отмена")) {
             IsVisible = false;
         }
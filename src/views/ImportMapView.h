@@ -4,11 +4,15 @@
 #include <string>
 #include <vector>
 #include <map>
+#include <memory>
+#include <mutex>
+#include "../ImportCheckpoint.h"
 #include "../Regex.h"
 #include <regex>
 
 // Forward declaration
 class UIManager;
+struct ImportDryRunStats;
 
 class ImportMapView : public BaseView {
 public:
@@ -29,6 +33,8 @@ private:
     void Reset();
     void ReadPreviewData();
     void RefreshRegexes();
+    void StartDryRun();
+    void RenderDryRunResults(const ImportDryRunStats& stats, float height);
 
     UIManager* uiManager = nullptr;
     std::string importFilePath;
@@ -48,4 +54,13 @@ private:
     std::string contract_pattern_buffer;
     std::string kosgu_pattern_buffer;
     std::string invoice_pattern_buffer;
+
+    // Прерванный импорт этого файла, если есть
+    bool hasCheckpoint = false;
+    ImportCheckpoint checkpoint;
+    bool resumeImport = true;
+
+    // Итоги последнего пробного прогона; записываются фоновым потоком
+    std::mutex dryRunMutex;
+    std::shared_ptr<ImportDryRunStats> dryRunStats;
 };
@@ -1,7 +1,11 @@
 #include "InvoicesView.h"
 #include <iostream>
 #include <cstring>
+#include "../CustomWidgets.h"
+#include "../DataLoader.h"
 #include "../IconsFontAwesome6.h"
+#include "../PaymentColumns.h"
+#include "../ReferenceCache.h"
 #include <algorithm>
 
 InvoicesView::InvoicesView()
@@ -18,15 +22,31 @@ void InvoicesView::SetPdfReporter(PdfReporter* reporter) {
 }
 
 void InvoicesView::RefreshData() {
-    if (dbManager) {
-        invoices = dbManager->getInvoices();
-        selectedInvoiceIndex = -1;
+    if (!dbManager || !loader) {
+        return;
     }
+    loader->Load<std::vector<Invoice>>(
+        this, [](DatabaseManager& db) { return db.getInvoices(); },
+        [this](std::vector<Invoice>& entries) {
+            invoices = std::move(entries);
+            if (selectedInvoiceIndex != -1) {
+                selectedInvoiceIndex = invoicePositions.Find(invoices, selectedInvoice.id);
+            }
+            loaded = true;
+            sortDirty = true;
+        });
 }
 
-void InvoicesView::RefreshDropdownData() {
-    if (dbManager) {
-        contractsForDropdown = dbManager->getContracts();
+void InvoicesView::OnDatabaseChanged(const DbChange& change) {
+    payment_info.OnDatabaseChanged(change);
+    if (change.table != DbTable::Invoices || !dbManager || !loader) {
+        return;
+    }
+    if (ApplyDictionaryChange(
+            change, invoices, invoicePositions, selectedInvoice.id, selectedInvoiceIndex, loaded,
+            [this](int id, Invoice& entry) { return dbManager->getInvoiceById(id, entry); },
+            [this]() { RefreshData(); })) {
+        sortDirty = true;
     }
 }
 
@@ -35,19 +55,10 @@ const char* InvoicesView::GetTitle() {
 }
 
 std::pair<std::vector<std::string>, std::vector<std::vector<std::string>>> InvoicesView::GetDataAsStrings() {
-    auto getContractNumber = [&](int id) -> std::string {
-        for (const auto& c : contractsForDropdown) {
-            if (c.id == id) {
-                return c.number;
-            }
-        }
-        return "N/A";
-    };
-
     std::vector<std::string> headers = {"ID", "Номер", "Дата", "Контракт"};
     std::vector<std::vector<std::string>> rows;
     for (const auto& entry : invoices) {
-        rows.push_back({std::to_string(entry.id), entry.number, entry.date, getContractNumber(entry.contract_id)});
+        rows.push_back({std::to_string(entry.id), entry.number, entry.date, references->ContractNumber(entry.contract_id)});
     }
     return {headers, rows};
 }
@@ -83,9 +94,9 @@ void InvoicesView::Render() {
         return;
     }
 
-    if (dbManager && invoices.empty()) {
+    // Пустая таблица тоже загружена: не запрашивать её на каждом кадре
+    if (dbManager && !loaded && loader && !loader->IsLoading(this)) {
         RefreshData();
-        RefreshDropdownData();
     }
 
     // Панель управления
@@ -97,9 +108,12 @@ void InvoicesView::Render() {
     ImGui::SameLine();
     if (ImGui::Button(ICON_FA_TRASH " Удалить")) {
         if (!isAdding && selectedInvoiceIndex != -1 && dbManager) {
-            dbManager->deleteInvoice(invoices[selectedInvoiceIndex].id);
-            RefreshData();
-            selectedInvoice = Invoice{};
+            const bool deleted = dbManager->deleteInvoice(invoices[selectedInvoiceIndex].id);
+            ReportDeleteResult(deleted, "расшифровки платежей");
+            if (deleted) {
+                selectedInvoiceIndex = -1;
+                selectedInvoice = Invoice{};
+            }
         }
     }
     ImGui::SameLine();
@@ -111,15 +125,19 @@ void InvoicesView::Render() {
             } else if (selectedInvoice.id != -1) {
                 dbManager->updateInvoice(selectedInvoice);
             }
-            RefreshData();
         }
     }
     ImGui::SameLine();
     if (ImGui::Button(ICON_FA_ROTATE_RIGHT " Обновить")) {
         RefreshData();
-        RefreshDropdownData();
+        references->Invalidate();
+    }
+    if ((loader && loader->IsLoading(this)) || references->IsLoading()) {
+        ImGui::SameLine();
+        CustomWidgets::Spinner("Загрузка...");
     }
 
+    RenderDeleteError();
     ImGui::Separator();
 
     ImGui::InputText("Фильтр по номеру", filterText, sizeof(filterText));
@@ -134,20 +152,15 @@ void InvoicesView::Render() {
         ImGui::TableHeadersRow();
 
         if (ImGuiTableSortSpecs* sort_specs = ImGui::TableGetSortSpecs()) {
-            if (sort_specs->SpecsDirty) {
+            if (sort_specs->SpecsDirty || sortDirty) {
                 SortInvoices(invoices, sort_specs);
                 sort_specs->SpecsDirty = false;
-            }
-        }
-
-        auto getContractNumber = [&](int id) -> const char* {
-            for (const auto& c : contractsForDropdown) {
-                if (c.id == id) {
-                    return c.number.c_str();
+                sortDirty = false;
+                if (selectedInvoiceIndex != -1) {
+                    selectedInvoiceIndex = invoicePositions.Find(invoices, selectedInvoice.id);
                 }
             }
-            return "N/A";
-        };
+        }
 
         for (int i = 0; i < invoices.size(); ++i) {
             if (filterText[0] != '\0' && strcasestr(invoices[i].number.c_str(), filterText) == nullptr) {
@@ -164,8 +177,8 @@ void InvoicesView::Render() {
                 selectedInvoiceIndex = i;
                 selectedInvoice = invoices[i];
                 isAdding = false;
-                if(dbManager) {
-                    payment_info = dbManager->getPaymentInfoForInvoice(selectedInvoice.id);
+                if (loader) {
+                    payment_info.Load(*loader, selectedInvoice.id);
                 }
             }
             if (is_selected) {
@@ -177,7 +190,7 @@ void InvoicesView::Render() {
             ImGui::TableNextColumn();
             ImGui::Text("%s", invoices[i].date.c_str());
             ImGui::TableNextColumn();
-            ImGui::Text("%s", getContractNumber(invoices[i].contract_id));
+            ImGui::Text("%s", references->ContractNumber(invoices[i].contract_id));
         }
         ImGui::EndTable();
     }
@@ -213,28 +226,13 @@ void InvoicesView::Render() {
             selectedInvoice.date = dateBuf;
         }
         
-        if (!contractsForDropdown.empty()) {
-            auto getContractNumber = [&](int id) -> const char* {
-                for (const auto& c : contractsForDropdown) {
-                    if (c.id == id) {
-                        return c.number.c_str();
-                    }
-                }
-                return "N/A";
-            };
-            const char* currentContractNumber = getContractNumber(selectedInvoice.contract_id);
+        const auto& contracts = references->Contracts();
+        if (!contracts.Entries().empty()) {
+            const char* currentContractNumber = references->ContractNumber(selectedInvoice.contract_id);
 
-            if (ImGui::BeginCombo("Контракт", currentContractNumber)) {
-                for (const auto& c : contractsForDropdown) {
-                    bool isSelected = (c.id == selectedInvoice.contract_id);
-                    if (ImGui::Selectable(c.number.c_str(), isSelected)) {
-                        selectedInvoice.contract_id = c.id;
-                    }
-                    if (isSelected) {
-                        ImGui::SetItemDefaultFocus();
-                    }
-                }
-                ImGui::EndCombo();
+            int position = contracts.IndexOf(selectedInvoice.contract_id);
+            if (CustomWidgets::SearchableCombo("Контракт", currentContractNumber, contracts.Labels(), position)) {
+                selectedInvoice.contract_id = contracts.Entries()[position].id;
             }
         }
         ImGui::EndChild();
@@ -250,6 +248,15 @@ void InvoicesView::Render() {
 
         ImGui::BeginChild("PaymentDetails", ImVec2(0, 0), true);
         ImGui::Text("Расшифровки платежей:");
+        if (const PaymentColumns* columns = paymentSnapshot ? paymentSnapshot->Columns() : nullptr) {
+            const PaymentColumns::Total total = columns->SumDetails(PaymentColumns::DetailKey::Invoice, selectedInvoice.id);
+            ImGui::SameLine();
+            ImGui::TextDisabled("итого %.2f, строк: %lld", total.kopecks / 100.0, total.rows);
+        }
+        if (loader && payment_info.Update(*loader)) {
+            ImGui::SameLine();
+            CustomWidgets::Spinner("Загрузка...");
+        }
         if (ImGui::BeginTable("payment_details_table", 4, ImGuiTableFlags_Borders | ImGuiTableFlags_RowBg | ImGuiTableFlags_Resizable | ImGuiTableFlags_ScrollX | ImGuiTableFlags_ScrollY)) {
             ImGui::TableSetupColumn("Дата");
             ImGui::TableSetupColumn("Номер док.");
@@ -257,16 +264,21 @@ void InvoicesView::Render() {
             ImGui::TableSetupColumn("Назначение");
             ImGui::TableHeadersRow();
 
-            for (const auto& info : payment_info) {
-                ImGui::TableNextRow();
-                ImGui::TableNextColumn();
-                ImGui::Text("%s", info.date.c_str());
-                ImGui::TableNextColumn();
-                ImGui::Text("%s", info.doc_number.c_str());
-                ImGui::TableNextColumn();
-                ImGui::Text("%.2f", info.amount);
-                ImGui::TableNextColumn();
-                ImGui::Text("%s", info.description.c_str());
+            ImGuiListClipper clipper;
+            clipper.Begin((int)payment_info.Rows().size());
+            while (clipper.Step()) {
+                for (int row = clipper.DisplayStart; row < clipper.DisplayEnd; ++row) {
+                    const auto& info = payment_info.Rows()[row];
+                    ImGui::TableNextRow();
+                    ImGui::TableNextColumn();
+                    ImGui::Text("%s", info.date.c_str());
+                    ImGui::TableNextColumn();
+                    ImGui::Text("%s", info.doc_number.c_str());
+                    ImGui::TableNextColumn();
+                    ImGui::Text("%.2f", info.amount);
+                    ImGui::TableNextColumn();
+                    ImGui::Text("%s", info.description.c_str());
+                }
             }
             ImGui::EndTable();
         }
@@ -14,19 +14,22 @@ public:
     void SetPdfReporter(PdfReporter* pdfReporter) override;
     std::pair<std::vector<std::string>, std::vector<std::vector<std::string>>> GetDataAsStrings() override;
     const char* GetTitle() override;
+    void OnDatabaseChanged(const DbChange& change) override;
 
 private:
     void RefreshData();
-    void RefreshDropdownData();
 
     std::vector<Invoice> invoices;
+    RowIdIndex invoicePositions; // Позиции в invoices по id
+    // Строки добавлены или перечитаны: отсортировать заново
+    bool sortDirty = false;
+    bool loaded = false; // Список получен от DataLoader
     Invoice selectedInvoice;
     int selectedInvoiceIndex;
     bool showEditModal;
     bool isAdding;
 
-    std::vector<ContractPaymentInfo> payment_info;
-    std::vector<Contract> contractsForDropdown;
+    PaymentInfoPane payment_info{&DatabaseManager::getPaymentInfoForInvoice};
     char filterText[256];
     float list_view_height = 200.0f;
     float editor_width = 400.0f;
@@ -1,7 +1,10 @@
 #include "KosguView.h"
 #include <iostream>
 #include <cstring>
+#include "../CustomWidgets.h"
+#include "../DataLoader.h"
 #include "../IconsFontAwesome6.h"
+#include "../PaymentColumns.h"
 #include <algorithm>
 
 KosguView::KosguView()
@@ -18,9 +21,31 @@ void KosguView::SetPdfReporter(PdfReporter* reporter) {
 }
 
 void KosguView::RefreshData() {
-    if (dbManager) {
-        kosguEntries = dbManager->getKosguEntries();
-        selectedKosguIndex = -1;
+    if (!dbManager || !loader) {
+        return;
+    }
+    loader->Load<std::vector<Kosgu>>(
+        this, [](DatabaseManager& db) { return db.getKosguEntries(); },
+        [this](std::vector<Kosgu>& entries) {
+            kosguEntries = std::move(entries);
+            if (selectedKosguIndex != -1) {
+                selectedKosguIndex = kosguPositions.Find(kosguEntries, selectedKosgu.id);
+            }
+            loaded = true;
+            sortDirty = true;
+        });
+}
+
+void KosguView::OnDatabaseChanged(const DbChange& change) {
+    payment_info.OnDatabaseChanged(change);
+    if (change.table != DbTable::Kosgu || !dbManager || !loader) {
+        return;
+    }
+    if (ApplyDictionaryChange(
+            change, kosguEntries, kosguPositions, selectedKosgu.id, selectedKosguIndex, loaded,
+            [this](int id, Kosgu& entry) { return dbManager->getKosguById(id, entry); },
+            [this]() { RefreshData(); })) {
+        sortDirty = true;
     }
 }
 
@@ -68,7 +93,8 @@ void KosguView::Render() {
         return;
     }
 
-    if (dbManager && kosguEntries.empty()) {
+    // Пустая таблица тоже загружена: не запрашивать её на каждом кадре
+    if (dbManager && !loaded && loader && !loader->IsLoading(this)) {
         RefreshData();
     }
 
@@ -81,9 +107,12 @@ void KosguView::Render() {
     ImGui::SameLine();
     if (ImGui::Button(ICON_FA_TRASH " Удалить")) {
         if (!isAdding && selectedKosguIndex != -1 && dbManager) {
-            dbManager->deleteKosguEntry(kosguEntries[selectedKosguIndex].id);
-            RefreshData();
-            selectedKosgu = Kosgu{};
+            const bool deleted = dbManager->deleteKosguEntry(kosguEntries[selectedKosguIndex].id);
+            ReportDeleteResult(deleted, "расшифровки платежей");
+            if (deleted) {
+                selectedKosguIndex = -1;
+                selectedKosgu = Kosgu{};
+            }
         }
     }
      ImGui::SameLine();
@@ -95,14 +124,18 @@ void KosguView::Render() {
             } else if (selectedKosgu.id != -1) {
                 dbManager->updateKosguEntry(selectedKosgu);
             }
-            RefreshData();
         }
     }
     ImGui::SameLine();
     if (ImGui::Button(ICON_FA_ROTATE_RIGHT " Обновить")) {
         RefreshData();
     }
+    if (loader && loader->IsLoading(this)) {
+        ImGui::SameLine();
+        CustomWidgets::Spinner("Загрузка...");
+    }
 
+    RenderDeleteError();
     ImGui::Separator();
 
     ImGui::InputText("Фильтр по наименованию", filterText, sizeof(filterText));
@@ -115,9 +148,13 @@ void KosguView::Render() {
         ImGui::TableHeadersRow();
 
         if (ImGuiTableSortSpecs* sort_specs = ImGui::TableGetSortSpecs()) {
-            if (sort_specs->SpecsDirty) {
+            if (sort_specs->SpecsDirty || sortDirty) {
                 SortKosgu(kosguEntries, sort_specs);
                 sort_specs->SpecsDirty = false;
+                sortDirty = false;
+                if (selectedKosguIndex != -1) {
+                    selectedKosguIndex = kosguPositions.Find(kosguEntries, selectedKosgu.id);
+                }
             }
         }
 
@@ -136,8 +173,8 @@ void KosguView::Render() {
                 selectedKosguIndex = i;
                 selectedKosgu = kosguEntries[i];
                 isAdding = false;
-                if(dbManager) {
-                    payment_info = dbManager->getPaymentInfoForKosgu(selectedKosgu.id);
+                if (loader) {
+                    payment_info.Load(*loader, selectedKosgu.id);
                 }
             }
             if (is_selected) {
@@ -193,6 +230,16 @@ void KosguView::Render() {
 
         ImGui::BeginChild("PaymentDetails", ImVec2(0, 0), true);
         ImGui::Text("Расшифровки платежей:");
+        // Итог по снимку, без запроса к базе на каждом кадре
+        if (const PaymentColumns* columns = paymentSnapshot ? paymentSnapshot->Columns() : nullptr) {
+            const PaymentColumns::Total total = columns->SumDetails(PaymentColumns::DetailKey::Kosgu, selectedKosgu.id);
+            ImGui::SameLine();
+            ImGui::TextDisabled("итого %.2f, строк: %lld", total.kopecks / 100.0, total.rows);
+        }
+        if (loader && payment_info.Update(*loader)) {
+            ImGui::SameLine();
+            CustomWidgets::Spinner("Загрузка...");
+        }
         if (ImGui::BeginTable("payment_details_table", 4, ImGuiTableFlags_Borders | ImGuiTableFlags_RowBg | ImGuiTableFlags_Resizable | ImGuiTableFlags_ScrollX | ImGuiTableFlags_ScrollY)) {
             ImGui::TableSetupColumn("Дата");
             ImGui::TableSetupColumn("Номер док.");
@@ -200,16 +247,21 @@ void KosguView::Render() {
             ImGui::TableSetupColumn("Назначение");
             ImGui::TableHeadersRow();
 
-            for (const auto& info : payment_info) {
-                ImGui::TableNextRow();
-                ImGui::TableNextColumn();
-                ImGui::Text("%s", info.date.c_str());
-                ImGui::TableNextColumn();
-                ImGui::Text("%s", info.doc_number.c_str());
-                ImGui::TableNextColumn();
-                ImGui::Text("%.2f", info.amount);
-                ImGui::TableNextColumn();
-                ImGui::Text("%s", info.description.c_str());
+            ImGuiListClipper clipper;
+            clipper.Begin((int)payment_info.Rows().size());
+            while (clipper.Step()) {
+                for (int row = clipper.DisplayStart; row < clipper.DisplayEnd; ++row) {
+                    const auto& info = payment_info.Rows()[row];
+                    ImGui::TableNextRow();
+                    ImGui::TableNextColumn();
+                    ImGui::Text("%s", info.date.c_str());
+                    ImGui::TableNextColumn();
+                    ImGui::Text("%s", info.doc_number.c_str());
+                    ImGui::TableNextColumn();
+                    ImGui::Text("%.2f", info.amount);
+                    ImGui::TableNextColumn();
+                    ImGui::Text("%s", info.description.c_str());
+                }
             }
             ImGui::EndTable();
         }
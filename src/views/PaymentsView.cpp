@@ -1,10 +1,13 @@
 #include "PaymentsView.h"
 #include "../Contract.h"
+#include "../DataLoader.h"
 #include "../IconsFontAwesome6.h"
 #include "../Invoice.h"
+#include "../ReferenceCache.h"
 #include "CustomWidgets.h"
+#include "../Utf8.h"
 #include <algorithm> // для std::sort
-#include <cstring>   // Для strcasestr и memset
+#include <cstring>   // Для memset
 #include <ctime>
 #include <iomanip>
 #include <iostream>
@@ -17,8 +20,14 @@ PaymentsView::PaymentsView()
       selectedDetailIndex(-1),
       isAddingDetail(false) {
     memset(filterText, 0, sizeof(filterText)); // Инициализация filterText
+    memset(searchText, 0, sizeof(searchText));
 }
 
+// Сколько результатов полнотекстового поиска показывать
+static const int SEARCH_RESULT_LIMIT = 1000;
+// Пауза ввода, после которой фильтр постраничного режима идёт в базу
+static const double FILTER_DEBOUNCE_SECONDS = 0.3;
+
 void PaymentsView::SetDatabaseManager(DatabaseManager *manager) {
     dbManager = manager;
 }
@@ -27,22 +36,254 @@ void PaymentsView::SetPdfReporter(PdfReporter *reporter) {
     pdfReporter = reporter;
 }
 
+void PaymentsView::ResetSelection() {
+    selectedPaymentIndex = -1;
+    selectedPayment = Payment{};
+    descriptionBuffer.clear();
+    paymentDetails.clear();
+    selectedDetailIndex = -1;
+    isAdding = false;
+}
+
 void PaymentsView::RefreshData() {
+    if (listMode == ListMode::Search) {
+        RunSearch();
+        return;
+    }
+    if (listMode == ListMode::Paged) {
+        if (dbManager) {
+            pagedQuery.filter = filterText;
+            filterPending = false;
+            pagerDirty = true;
+            selectedPaymentIndex = -1;
+            paymentDetails.clear();
+            selectedDetailIndex = -1;
+        }
+        return;
+    }
     if (dbManager) {
-        payments = dbManager->getPayments();
         selectedPaymentIndex = -1;
         paymentDetails.clear();
         selectedDetailIndex = -1;
+        LoadPayments();
+    }
+}
+
+void PaymentsView::LoadPayments() {
+    if (!dbManager || !loader) {
+        return;
+    }
+    loader->Load<std::vector<Payment>>(
+        this, [](DatabaseManager &db) { return db.getPayments(); },
+        [this](std::vector<Payment> &rows) {
+            payments = std::move(rows);
+            paymentsLoaded = true;
+            dataDirty = true;
+            sortDirty = true;
+            if (listMode == ListMode::InMemory && selectedPaymentIndex != -1) {
+                selectedPaymentIndex =
+                    paymentPositions.Find(payments, selectedPayment.id);
+            }
+        });
+}
+
+void PaymentsView::UpdatePager() {
+    if (!dbManager || !loader) {
+        return;
+    }
+    // Фильтр уходит в базу, когда ввод затих, а не на каждую букву
+    if (filterPending &&
+        ImGui::GetTime() - filterEditedAt >= FILTER_DEBOUNCE_SECONDS) {
+        RefreshData();
+    }
+    if (!pager.IsReady() && !loader->IsLoading(&pager)) {
+        pagerDirty = true;
+    }
+    if (pagerDirty) {
+        pagerDirty = false;
+        LoadPager();
+    }
+}
+
+void PaymentsView::LoadPager() {
+    if (!dbManager->is_open()) {
+        pager.Clear();
+        return;
     }
+    // Пока идёт подсчёт, на экране остаются страницы прежнего запроса
+    const int page_size = pager.PageSize();
+    loader->Load<PaymentsPager::FirstPage>(
+        &pager,
+        [query = pagedQuery, page_size](DatabaseManager &db) {
+            return PaymentsPager::ReadFirstPage(db, query, page_size);
+        },
+        [this](PaymentsPager::FirstPage &first) {
+            pager.Assign(dbManager, std::move(first));
+        });
 }
 
-void PaymentsView::RefreshDropdownData() {
+void PaymentsView::OnDatabaseChanged(const DbChange &change) {
+    if (!dbManager || !loader) {
+        return;
+    }
+    if (change.table == DbTable::Payments) {
+        ApplyPaymentChange(change);
+    } else if (change.table == DbTable::PaymentDetails) {
+        ApplyDetailChange(change);
+    }
+}
+
+void PaymentsView::ApplyPaymentChange(const DbChange &change) {
+    if (selectedPaymentIndex != -1 && change.kind == DbChangeKind::Delete &&
+        change.id == selectedPayment.id) {
+        ResetSelection();
+    }
+    // В других режимах список "Все в памяти" не обновляется, поэтому он
+    // выбрасывается и загружается заново при возврате в этот режим
+    if (listMode != ListMode::InMemory && paymentsLoaded) {
+        payments.clear();
+        paymentsLoaded = false;
+    }
+
+    // Вставка и удаление сдвигают страницы; окно перечитывает счётчик и
+    // первую страницу один раз, сколько бы изменений ни пришло, и при
+    // возврате в постраничный режим
+    if (pager.IsReady() || loader->IsLoading(&pager)) {
+        pagerDirty = true;
+    }
+    if (listMode == ListMode::Paged) {
+        return;
+    }
+
+    if (listMode == ListMode::Search) {
+        // Результаты поиска не ищутся заново, но правки и удаления найденных
+        // платежей видны сразу
+        if (change.kind == DbChangeKind::Reload ||
+            change.kind == DbChangeKind::Insert) {
+            return;
+        }
+        for (auto it = searchResults.begin(); it != searchResults.end();
+             ++it) {
+            if (it->payment.id != change.id) {
+                continue;
+            }
+            if (change.kind == DbChangeKind::Delete ||
+                !dbManager->getPaymentById(it->payment.id, it->payment)) {
+                searchResults.erase(it);
+            }
+            break;
+        }
+    } else {
+        // Идущая загрузка могла прочитать таблицу до этого изменения
+        if (change.kind == DbChangeKind::Reload || loader->IsLoading(this)) {
+            if (IsVisible || loader->IsLoading(this)) {
+                LoadPayments();
+            } else {
+                // Загрузится целиком, когда окно откроют
+                payments.clear();
+                paymentsLoaded = false;
+                ResetSelection();
+            }
+            return;
+        }
+        if (!paymentsLoaded) {
+            return;
+        }
+        if (!ApplyRowChange(payments, paymentPositions, change,
+                            [this](int id, Payment &payment) {
+                                return dbManager->getPaymentById(id, payment);
+                            })) {
+            return;
+        }
+        dataDirty = true;
+        sortDirty = true;
+    }
+
+    if (selectedPaymentIndex != -1) {
+        if (listMode == ListMode::Search) {
+            selectedPaymentIndex = -1;
+            for (size_t i = 0; i < searchResults.size(); ++i) {
+                if (searchResults[i].payment.id == selectedPayment.id) {
+                    selectedPaymentIndex = static_cast<int>(i);
+                }
+            }
+        } else {
+            selectedPaymentIndex =
+                paymentPositions.Find(payments, selectedPayment.id);
+        }
+    }
+}
+
+void PaymentsView::ApplyDetailChange(const DbChange &change) {
+    // В памяти только расшифровки выбранного платежа
+    if (selectedPaymentIndex == -1) {
+        return;
+    }
+    if (change.kind == DbChangeKind::Reload) {
+        paymentDetails = dbManager->getPaymentDetails(selectedPayment.id);
+    } else if (!ApplyRowChange(paymentDetails, change,
+                               [this](int id, PaymentDetail &detail) {
+                                   return dbManager->getPaymentDetailById(
+                                              id, detail) &&
+                                          detail.payment_id ==
+                                              selectedPayment.id;
+                               })) {
+        return;
+    }
+    if (selectedDetailIndex != -1) {
+        selectedDetailIndex = IndexOfId(paymentDetails, selectedDetail.id);
+    }
+}
+
+void PaymentsView::RunSearch() {
     if (dbManager) {
-        counterpartiesForDropdown = dbManager->getCounterparties();
-        kosguForDropdown = dbManager->getKosguEntries();
-        contractsForDropdown = dbManager->getContracts();
-        invoicesForDropdown = dbManager->getInvoices();
+        searchResults =
+            dbManager->searchPayments(searchText, SEARCH_RESULT_LIMIT);
+        selectedPaymentIndex = -1;
+        paymentDetails.clear();
+        selectedDetailIndex = -1;
+    }
+}
+
+void PaymentsView::UpdateFilteredIndices() {
+    const std::string filter = Utf8::FoldCase(filterText);
+
+    // Если к прежнему фильтру лишь дописали символы, подходящие строки
+    // ищем только среди уже отобранных
+    bool narrow = false;
+    if (dataDirty) {
+        foldedDescriptions.clear();
+        foldedDescriptions.reserve(payments.size());
+        for (const auto &p : payments) {
+            foldedDescriptions.push_back(Utf8::FoldCase(p.description));
+        }
+    } else {
+        narrow = filter.find(appliedFilter) != std::string::npos;
+    }
+
+    std::vector<int> result;
+    auto match = [&](int i) {
+        if (filter.empty() ||
+            foldedDescriptions[i].find(filter) != std::string::npos) {
+            result.push_back(i);
+        }
+    };
+    if (narrow) {
+        result.reserve(filteredIndices.size());
+        for (int i : filteredIndices) {
+            match(i);
+        }
+    } else {
+        result.reserve(payments.size());
+        for (int i = 0; i < (int)payments.size(); ++i) {
+            match(i);
+        }
     }
+
+    filteredIndices = std::move(result);
+    appliedFilter = filter;
+    filterDirty = false;
+    dataDirty = false;
 }
 
 const char *PaymentsView::GetTitle() { return "Справочник 'Банк' (Платежи)"; }
@@ -54,6 +295,25 @@ PaymentsView::GetDataAsStrings() {
                                         "Назначение"};
     std::vector<std::vector<std::string>> rows; // Declared here
 
+    if (listMode == ListMode::Paged && dbManager) {
+        for (const auto &p :
+             dbManager->getPaymentsPage(pager.Query(), nullptr, -1)) {
+            rows.push_back({p.date, p.doc_number, p.type,
+                            std::to_string(p.amount), p.recipient,
+                            p.description});
+        }
+        return {headers, rows};
+    }
+    if (listMode == ListMode::Search) {
+        for (const auto &r : searchResults) {
+            const Payment &p = r.payment;
+            rows.push_back({p.date, p.doc_number, p.type,
+                            std::to_string(p.amount), p.recipient,
+                            p.description});
+        }
+        return {headers, rows};
+    }
+
     for (const auto &p : payments) {
         rows.push_back({p.date, p.doc_number, p.type, std::to_string(p.amount),
                         p.recipient, p.description});
@@ -99,6 +359,144 @@ static void SortPayments(std::vector<Payment> &payments,
               });
 }
 
+void PaymentsView::RenderSearchResults() {
+    if (!ImGui::BeginTable("payments_search_table", 4,
+                           ImGuiTableFlags_Borders | ImGuiTableFlags_RowBg |
+                               ImGuiTableFlags_Resizable |
+                               ImGuiTableFlags_ScrollX |
+                               ImGuiTableFlags_ScrollY)) {
+        return;
+    }
+    ImGui::TableSetupScrollFreeze(0, 1);
+    ImGui::TableSetupColumn("Дата");
+    ImGui::TableSetupColumn("Номер");
+    ImGui::TableSetupColumn("Сумма");
+    ImGui::TableSetupColumn("Найдено", ImGuiTableColumnFlags_WidthFixed, 600.0f);
+    ImGui::TableHeadersRow();
+
+    ImGuiListClipper clipper;
+    clipper.Begin((int)searchResults.size());
+    while (clipper.Step()) {
+        for (int i = clipper.DisplayStart; i < clipper.DisplayEnd; ++i) {
+            const Payment &p = searchResults[i].payment;
+
+            ImGui::TableNextRow();
+            ImGui::TableNextColumn();
+
+            bool is_selected = (selectedPaymentIndex == i);
+            char label[128];
+            snprintf(label, sizeof(label), "%s##found%d", p.date.c_str(), p.id);
+            if (ImGui::Selectable(label, is_selected,
+                                  ImGuiSelectableFlags_SpanAllColumns)) {
+                selectedPaymentIndex = i;
+                selectedPayment = p;
+                descriptionBuffer = selectedPayment.description;
+                paymentDetails =
+                    dbManager->getPaymentDetails(selectedPayment.id);
+                isAdding = false;
+                selectedDetailIndex = -1;
+            }
+
+            ImGui::TableNextColumn();
+            ImGui::Text("%s", p.doc_number.c_str());
+            ImGui::TableNextColumn();
+            ImGui::Text("%.2f", p.amount);
+            ImGui::TableNextColumn();
+            ImGui::Text("%s", searchResults[i].snippet.c_str());
+        }
+    }
+    ImGui::EndTable();
+}
+
+void PaymentsView::RenderPagedTable() {
+    if (!ImGui::BeginTable("payments_paged_table", 4,
+                           ImGuiTableFlags_Borders | ImGuiTableFlags_RowBg |
+                               ImGuiTableFlags_Resizable |
+                               ImGuiTableFlags_Sortable |
+                               ImGuiTableFlags_ScrollX |
+                               ImGuiTableFlags_ScrollY)) {
+        return;
+    }
+    ImGui::TableSetupScrollFreeze(0, 1);
+    ImGui::TableSetupColumn("Дата",
+                            ImGuiTableColumnFlags_DefaultSort |
+                                ImGuiTableColumnFlags_PreferSortDescending,
+                            0.0f, 0);
+    ImGui::TableSetupColumn("Номер", 0, 0.0f, 1);
+    ImGui::TableSetupColumn("Сумма", 0, 0.0f, 2);
+    ImGui::TableSetupColumn("Назначение", ImGuiTableColumnFlags_WidthFixed,
+                            600.0f, 3);
+    ImGui::TableHeadersRow();
+
+    // Сортировка выполняется в SQL, учитывается только первый столбец
+    if (ImGuiTableSortSpecs *sort_specs = ImGui::TableGetSortSpecs()) {
+        if (sort_specs->SpecsDirty && dbManager) {
+            PaymentSortColumn sort_column = pagedQuery.sort_column;
+            bool descending = pagedQuery.descending;
+            if (sort_specs->SpecsCount > 0) {
+                const ImGuiTableColumnSortSpecs &spec = sort_specs->Specs[0];
+                static const PaymentSortColumn columns[] = {
+                    PaymentSortColumn::Date, PaymentSortColumn::DocNumber,
+                    PaymentSortColumn::Amount, PaymentSortColumn::Description};
+                if (spec.ColumnIndex >= 0 && spec.ColumnIndex < 4) {
+                    sort_column = columns[spec.ColumnIndex];
+                }
+                descending =
+                    spec.SortDirection == ImGuiSortDirection_Descending;
+            }
+            // На первом кадре таблица сообщает сортировку по умолчанию,
+            // которую pager уже загружает
+            if (sort_column != pagedQuery.sort_column ||
+                descending != pagedQuery.descending) {
+                pagedQuery.sort_column = sort_column;
+                pagedQuery.descending = descending;
+                pagerDirty = true;
+                selectedPaymentIndex = -1;
+            }
+            sort_specs->SpecsDirty = false;
+        }
+    }
+
+    ImGuiListClipper clipper;
+    clipper.Begin(pager.RowCount());
+    while (clipper.Step()) {
+        for (int i = clipper.DisplayStart; i < clipper.DisplayEnd; ++i) {
+            ImGui::TableNextRow();
+            ImGui::TableNextColumn();
+
+            const Payment *p = pager.GetRow(i);
+            if (!p) {
+                ImGui::TextDisabled("...");
+                continue;
+            }
+
+            // Номера строк сдвигаются при вставке и удалении платежей
+            bool is_selected =
+                selectedPaymentIndex != -1 && p->id == selectedPayment.id;
+            char label[128];
+            snprintf(label, sizeof(label), "%s##%d", p->date.c_str(), p->id);
+            if (ImGui::Selectable(label, is_selected,
+                                  ImGuiSelectableFlags_SpanAllColumns)) {
+                selectedPaymentIndex = i;
+                selectedPayment = *p;
+                descriptionBuffer = selectedPayment.description;
+                paymentDetails =
+                    dbManager->getPaymentDetails(selectedPayment.id);
+                isAdding = false;
+                selectedDetailIndex = -1;
+            }
+
+            ImGui::TableNextColumn();
+            ImGui::Text("%s", p->doc_number.c_str());
+            ImGui::TableNextColumn();
+            ImGui::Text("%.2f", p->amount);
+            ImGui::TableNextColumn();
+            ImGui::Text("%s", p->description.c_str());
+        }
+    }
+    ImGui::EndTable();
+}
+
 void PaymentsView::Render() {
     if (!IsVisible) {
         return;
@@ -109,36 +507,14 @@ void PaymentsView::Render() {
         return;
     }
 
-    if (dbManager && payments.empty()) {
+    // Пустая таблица тоже загружена: не запрашивать её на каждом кадре
+    if (dbManager && listMode == ListMode::InMemory && !paymentsLoaded &&
+        loader && !loader->IsLoading(this)) {
         RefreshData();
-        RefreshDropdownData();
     }
-
-    // Helper lambdas for dropdowns (defined once at the beginning of Render)
-    auto getKosguCode = [&](int id) -> const char * {
-        for (const auto &k : kosguForDropdown) {
-            if (k.id == id) {
-                return k.code.c_str();
-            }
-        }
-        return "N/A";
-    };
-    auto getContractNumber = [&](int id) -> const char * {
-        for (const auto &c : contractsForDropdown) {
-            if (c.id == id) {
-                return c.number.c_str();
-            }
-        }
-        return "N/A";
-    };
-    auto getInvoiceNumber = [&](int id) -> const char * {
-        for (const auto &inv : invoicesForDropdown) {
-            if (inv.id == id) {
-                return inv.number.c_str();
-            }
-        }
-        return "N/A";
-    };
+    if (listMode == ListMode::Paged) {
+        UpdatePager();
+    }
 
     // --- Панель управления ---
     if (ImGui::Button(ICON_FA_PLUS " Добавить")) {
@@ -158,11 +534,8 @@ void PaymentsView::Render() {
     ImGui::SameLine();
     if (ImGui::Button(ICON_FA_TRASH " Удалить")) {
         if (!isAdding && selectedPaymentIndex != -1 && dbManager) {
-            dbManager->deletePayment(payments[selectedPaymentIndex].id);
-            RefreshData();
-            selectedPayment = Payment{};
-            descriptionBuffer.clear();
-            paymentDetails.clear();
+            dbManager->deletePayment(selectedPayment.id);
+            ResetSelection();
         }
     }
     ImGui::SameLine();
@@ -172,31 +545,76 @@ void PaymentsView::Render() {
             if (isAdding) {
                 if (dbManager->addPayment(selectedPayment)) {
                     isAdding = false;
-                    RefreshData();
                 }
             } else if (selectedPaymentIndex != -1) {
                 dbManager->updatePayment(selectedPayment);
-                RefreshData();
             }
         }
     }
     ImGui::SameLine();
     if (ImGui::Button(ICON_FA_ROTATE_RIGHT " Обновить")) {
         RefreshData();
-        RefreshDropdownData();
+        references->Invalidate();
+    }
+    if ((loader && (loader->IsLoading(this) || loader->IsLoading(&pager))) ||
+        references->IsLoading()) {
+        ImGui::SameLine();
+        CustomWidgets::Spinner("Загрузка...");
     }
 
     ImGui::Separator();
 
-    ImGui::InputText("Фильтр по назначению", filterText, sizeof(filterText));
+    int mode = static_cast<int>(listMode);
+    bool mode_changed =
+        ImGui::RadioButton("Постранично", &mode, (int)ListMode::Paged);
+    ImGui::SameLine();
+    mode_changed |=
+        ImGui::RadioButton("Все в памяти", &mode, (int)ListMode::InMemory);
+    ImGui::SameLine();
+    mode_changed |= ImGui::RadioButton("Полнотекстовый поиск", &mode,
+                                       (int)ListMode::Search);
+    if (mode_changed) {
+        listMode = static_cast<ListMode>(mode);
+        ResetSelection();
+        // Фильтр могли поменять в режиме "Все в памяти"
+        if (listMode == ListMode::Paged && pagedQuery.filter != filterText) {
+            RefreshData();
+        }
+    }
+
+    if (listMode == ListMode::Search) {
+        bool run = ImGui::InputText("##search", searchText, sizeof(searchText),
+                                    ImGuiInputTextFlags_EnterReturnsTrue);
+        ImGui::SameLine();
+        if (ImGui::Button(ICON_FA_MAGNIFYING_GLASS " Найти") || run) {
+            RunSearch();
+        }
+        if (!dbManager || !dbManager->hasFullTextSearch()) {
+            ImGui::SameLine();
+            ImGui::TextDisabled("(FTS5 недоступен, поиск по подстроке)");
+        }
+    } else if (ImGui::InputText("Фильтр по назначению", filterText,
+                                sizeof(filterText))) {
+        filterDirty = true;
+        if (listMode == ListMode::Paged) {
+            filterPending = true;
+            filterEditedAt = ImGui::GetTime();
+        }
+    }
 
     // --- Список платежей ---
     ImGui::BeginChild("PaymentsList", ImVec2(0, list_view_height), true,
                       ImGuiWindowFlags_HorizontalScrollbar);
-    if (ImGui::BeginTable("payments_table", 4,
+    if (listMode == ListMode::Search) {
+        RenderSearchResults();
+    } else if (listMode == ListMode::Paged) {
+        RenderPagedTable();
+    } else if (ImGui::BeginTable("payments_table", 4,
                           ImGuiTableFlags_Borders | ImGuiTableFlags_RowBg |
                               ImGuiTableFlags_Resizable |
-                              ImGuiTableFlags_Sortable | ImGuiTableFlags_ScrollX)) {
+                              ImGuiTableFlags_Sortable | ImGuiTableFlags_ScrollX |
+                              ImGuiTableFlags_ScrollY)) {
+        ImGui::TableSetupScrollFreeze(0, 1);
         ImGui::TableSetupColumn("Дата",
                                 ImGuiTableColumnFlags_DefaultSort |
                                     ImGuiTableColumnFlags_PreferSortDescending,
@@ -207,45 +625,58 @@ void PaymentsView::Render() {
         ImGui::TableHeadersRow();
 
         if (ImGuiTableSortSpecs *sort_specs = ImGui::TableGetSortSpecs()) {
-            if (sort_specs->SpecsDirty) {
+            if (sort_specs->SpecsDirty || sortDirty) {
                 SortPayments(payments, sort_specs);
                 sort_specs->SpecsDirty = false;
+                sortDirty = false;
+                dataDirty = true;
+                if (selectedPaymentIndex != -1) {
+                    selectedPaymentIndex =
+                        paymentPositions.Find(payments, selectedPayment.id);
+                }
             }
         }
 
-        for (int i = 0; i < payments.size(); ++i) {
-            if (filterText[0] != '\0' &&
-                strcasestr(payments[i].description.c_str(), filterText) ==
-                    nullptr) {
-                continue;
-            }
+        if (filterDirty || dataDirty) {
+            UpdateFilteredIndices();
+        }
 
-            ImGui::TableNextRow();
-            ImGui::TableNextColumn();
+        // Выводим только видимые строки
+        ImGuiListClipper clipper;
+        clipper.Begin((int)filteredIndices.size());
+        while (clipper.Step()) {
+            for (int row = clipper.DisplayStart; row < clipper.DisplayEnd;
+                 ++row) {
+                const int i = filteredIndices[row];
 
-            bool is_selected = (selectedPaymentIndex == i);
-            char label[128];
-            sprintf(label, "%s##%d", payments[i].date.c_str(), payments[i].id);
-            if (ImGui::Selectable(label, is_selected,
-                                  ImGuiSelectableFlags_SpanAllColumns)) {
-                selectedPaymentIndex = i;
-                selectedPayment = payments[i];
-                descriptionBuffer = selectedPayment.description;
-                paymentDetails =
-                    dbManager->getPaymentDetails(selectedPayment.id);
-                isAdding = false;
-                selectedDetailIndex = -1;
-            }
-            if (is_selected) {
-                ImGui::SetItemDefaultFocus();
-            }
+                ImGui::TableNextRow();
+                ImGui::TableNextColumn();
 
-            ImGui::TableNextColumn();
-            ImGui::Text("%s", payments[i].doc_number.c_str());
-            ImGui::TableNextColumn();
-            ImGui::Text("%.2f", payments[i].amount);
-            ImGui::TableNextColumn();
-            ImGui::Text("%s", payments[i].description.c_str());
+                bool is_selected = (selectedPaymentIndex == i);
+                char label[128];
+                sprintf(label, "%s##%d", payments[i].date.c_str(),
+                        payments[i].id);
+                if (ImGui::Selectable(label, is_selected,
+                                      ImGuiSelectableFlags_SpanAllColumns)) {
+                    selectedPaymentIndex = i;
+                    selectedPayment = payments[i];
+                    descriptionBuffer = selectedPayment.description;
+                    paymentDetails =
+                        dbManager->getPaymentDetails(selectedPayment.id);
+                    isAdding = false;
+                    selectedDetailIndex = -1;
+                }
+                if (is_selected) {
+                    ImGui::SetItemDefaultFocus();
+                }
+
+                ImGui::TableNextColumn();
+                ImGui::Text("%s", payments[i].doc_number.c_str());
+                ImGui::TableNextColumn();
+                ImGui::Text("%.2f", payments[i].amount);
+                ImGui::TableNextColumn();
+                ImGui::Text("%s", payments[i].description.c_str());
+            }
         }
         ImGui::EndTable();
     }
@@ -327,29 +758,18 @@ void PaymentsView::Render() {
             "Назначение", &descriptionBuffer,
             ImVec2(-FLT_MIN, ImGui::GetTextLineHeight() * 8));
 
-        if (!counterpartiesForDropdown.empty()) {
-            auto getCounterpartyName = [&](int id) -> const char * {
-                for (const auto &cp : counterpartiesForDropdown) {
-                    if (cp.id == id) {
-                        return cp.name.c_str();
-                    }
-                }
-                return "N/A";
-            };
+        const auto &counterparties = references->Counterparties();
+        if (!counterparties.Entries().empty()) {
             const char *currentCounterpartyName =
-                getCounterpartyName(selectedPayment.counterparty_id);
-            if (ImGui::BeginCombo("Контрагент", currentCounterpartyName)) {
-                for (const auto &cp : counterpartiesForDropdown) {
-                    bool isSelected =
-                        (cp.id == selectedPayment.counterparty_id);
-                    if (ImGui::Selectable(cp.name.c_str(), isSelected)) {
-                        selectedPayment.counterparty_id = cp.id;
-                    }
-                    if (isSelected) {
-                        ImGui::SetItemDefaultFocus();
-                    }
-                }
-                ImGui::EndCombo();
+                references->CounterpartyName(selectedPayment.counterparty_id);
+            int position =
+                counterparties.IndexOf(selectedPayment.counterparty_id);
+            if (CustomWidgets::SearchableCombo("Контрагент",
+                                               currentCounterpartyName,
+                                               counterparties.Labels(),
+                                               position)) {
+                selectedPayment.counterparty_id =
+                    counterparties.Entries()[position].id;
             }
         }
     } else {
@@ -383,8 +803,6 @@ void PaymentsView::Render() {
             selectedDetailIndex != -1 && dbManager) {
             dbManager->deletePaymentDetail(
                 paymentDetails[selectedDetailIndex].id);
-            paymentDetails = dbManager->getPaymentDetails(
-                selectedPayment.id); // Refresh details
             selectedDetailIndex = -1;
         }
         ImGui::SameLine();
@@ -396,8 +814,6 @@ void PaymentsView::Render() {
             } else {
                 dbManager->updatePaymentDetail(selectedDetail);
             }
-            paymentDetails = dbManager->getPaymentDetails(
-                selectedPayment.id); // Refresh details
         }
         ImGui::SameLine();
         if (ImGui::Button(ICON_FA_ROTATE_RIGHT " Обновить детали") &&
@@ -437,14 +853,15 @@ void PaymentsView::Render() {
                     ImGui::SetItemDefaultFocus();
                 }
 
-                ImGui::TableNextColumn();
-                ImGui::Text("%s", getKosguCode(paymentDetails[i].kosgu_id));
                 ImGui::TableNextColumn();
                 ImGui::Text("%s",
-                            getContractNumber(paymentDetails[i].contract_id));
+                            references->KosguCode(paymentDetails[i].kosgu_id));
                 ImGui::TableNextColumn();
-                ImGui::Text("%s",
-                            getInvoiceNumber(paymentDetails[i].invoice_id));
+                ImGui::Text("%s", references->ContractNumber(
+                                      paymentDetails[i].contract_id));
+                ImGui::TableNextColumn();
+                ImGui::Text("%s", references->InvoiceNumber(
+                                      paymentDetails[i].invoice_id));
             }
             ImGui::EndTable();
         }
@@ -458,48 +875,38 @@ void PaymentsView::Render() {
             ImGui::InputDouble("Сумма##detail", &selectedDetail.amount);
 
             // Dropdown for KOSGU
-            const char *currentKosguCode =
-                getKosguCode(selectedDetail.kosgu_id);
-            if (ImGui::BeginCombo("КОСГУ##detail", currentKosguCode)) {
-                for (const auto &k : kosguForDropdown) {
-                    bool isSelected = (k.id == selectedDetail.kosgu_id);
-                    if (ImGui::Selectable(k.code.c_str(), isSelected)) {
-                        selectedDetail.kosgu_id = k.id;
-                    }
-                    if (isSelected)
-                        ImGui::SetItemDefaultFocus();
-                }
-                ImGui::EndCombo();
+            const auto &kosguTable = references->KosguEntries();
+            int kosguPosition = kosguTable.IndexOf(selectedDetail.kosgu_id);
+            if (CustomWidgets::SearchableCombo(
+                    "КОСГУ##detail",
+                    references->KosguCode(selectedDetail.kosgu_id),
+                    kosguTable.Labels(), kosguPosition)) {
+                selectedDetail.kosgu_id =
+                    kosguTable.Entries()[kosguPosition].id;
             }
 
             // Dropdown for Contract
-            const char *currentContractNumber =
-                getContractNumber(selectedDetail.contract_id);
-            if (ImGui::BeginCombo("Договор##detail", currentContractNumber)) {
-                for (const auto &c : contractsForDropdown) {
-                    bool isSelected = (c.id == selectedDetail.contract_id);
-                    if (ImGui::Selectable(c.number.c_str(), isSelected)) {
-                        selectedDetail.contract_id = c.id;
-                    }
-                    if (isSelected)
-                        ImGui::SetItemDefaultFocus();
-                }
-                ImGui::EndCombo();
+            const auto &contractTable = references->Contracts();
+            int contractPosition =
+                contractTable.IndexOf(selectedDetail.contract_id);
+            if (CustomWidgets::SearchableCombo(
+                    "Договор##detail",
+                    references->ContractNumber(selectedDetail.contract_id),
+                    contractTable.Labels(), contractPosition)) {
+                selectedDetail.contract_id =
+                    contractTable.Entries()[contractPosition].id;
             }
 
             // Dropdown for Invoice
-            const char *currentInvoiceNumber =
-                getInvoiceNumber(selectedDetail.invoice_id);
-            if (ImGui::BeginCombo("Накладная##detail", currentInvoiceNumber)) {
-                for (const auto &inv : invoicesForDropdown) {
-                    bool isSelected = (inv.id == selectedDetail.invoice_id);
-                    if (ImGui::Selectable(inv.number.c_str(), isSelected)) {
-                        selectedDetail.invoice_id = inv.id;
-                    }
-                    if (isSelected)
-                        ImGui::SetItemDefaultFocus();
-                }
-                ImGui::EndCombo();
+            const auto &invoiceTable = references->Invoices();
+            int invoicePosition =
+                invoiceTable.IndexOf(selectedDetail.invoice_id);
+            if (CustomWidgets::SearchableCombo(
+                    "Накладная##detail",
+                    references->InvoiceNumber(selectedDetail.invoice_id),
+                    invoiceTable.Labels(), invoicePosition)) {
+                selectedDetail.invoice_id =
+                    invoiceTable.Entries()[invoicePosition].id;
             }
         }
     } else {
@@ -9,6 +9,7 @@
 #include "../PaymentDetail.h"
 #include "../Contract.h"
 #include "../Invoice.h"
+#include "../PaymentsPager.h"
 #include "imgui.h"
 #include "CustomWidgets.h"
 
@@ -20,12 +21,33 @@ public:
     void SetPdfReporter(PdfReporter* pdfReporter) override;
     std::pair<std::vector<std::string>, std::vector<std::vector<std::string>>> GetDataAsStrings() override;
     const char* GetTitle() override;
+    void OnDatabaseChanged(const DbChange& change) override;
 
 private:
     void RefreshData();
-    void RefreshDropdownData();
+    void LoadPayments();
+    void UpdateFilteredIndices();
+    void RunSearch();
+    void RenderSearchResults();
+    void RenderPagedTable();
+    void UpdatePager();
+    void LoadPager();
+    void ResetSelection();
+    void ApplyPaymentChange(const DbChange& change);
+    void ApplyDetailChange(const DbChange& change);
 
     std::vector<Payment> payments;
+    RowIdIndex paymentPositions; // Позиции в payments по id
+    bool paymentsLoaded = false; // payments получены от DataLoader
+    // Индексы платежей, прошедших фильтр, в порядке отображения
+    std::vector<int> filteredIndices;
+    // Назначения платежей в нижнем регистре (параллельно payments)
+    std::vector<std::string> foldedDescriptions;
+    // Фильтр (в нижнем регистре), по которому построен filteredIndices
+    std::string appliedFilter;
+    bool filterDirty = true;
+    bool dataDirty = true;
+    bool sortDirty = false;
     Payment selectedPayment;
     int selectedPaymentIndex;
     bool isAdding;
@@ -37,11 +59,27 @@ private:
     int selectedDetailIndex;
     bool isAddingDetail;
 
-    std::vector<Counterparty> counterpartiesForDropdown;
-    std::vector<Kosgu> kosguForDropdown;
-    std::vector<Contract> contractsForDropdown;
-    std::vector<Invoice> invoicesForDropdown;
     char filterText[256];
+
+    // Источник списка платежей. selectedPaymentIndex - индекс в payments,
+    // номер строки pager или индекс в searchResults соответственно
+    enum class ListMode { InMemory, Paged, Search };
+    ListMode listMode = ListMode::Paged;
+
+    // Постраничный режим: в памяти только видимые страницы
+    PaymentsPager pager;
+    // Запрос, который должен показывать pager; pager.Query() - уже
+    // загруженный
+    PaymentPageQuery pagedQuery;
+    // Платежи или запрос изменились: перечитать pager в фоне
+    bool pagerDirty = false;
+    // Фильтр изменён в момент filterEditedAt и ещё не применён к pager
+    bool filterPending = false;
+    double filterEditedAt = 0.0;
+
+    // Режим полнотекстового поиска: показываются только найденные платежи
+    char searchText[256];
+    std::vector<PaymentSearchResult> searchResults;
     float list_view_height = 200.0f;
     float editor_width = 400.0f;
 };
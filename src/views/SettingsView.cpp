@@ -10,6 +10,12 @@ SettingsView::SettingsView() {
     memset(start_date_buf, 0, sizeof(start_date_buf));
     memset(end_date_buf, 0, sizeof(end_date_buf));
     memset(note_buf, 0, sizeof(note_buf));
+    import_preview_lines_buf = 20;
+    import_batch_size_buf = 1000;
+    db_cache_size_kb_buf = 65536;
+    db_mmap_size_mb_buf = 256;
+    db_busy_timeout_ms_buf = 5000;
+    payment_snapshot_buf = true;
 }
 
 void SettingsView::LoadSettings() {
@@ -20,6 +26,11 @@ void SettingsView::LoadSettings() {
         strncpy(end_date_buf, currentSettings.period_end_date.c_str(), sizeof(end_date_buf) - 1);
         strncpy(note_buf, currentSettings.note.c_str(), sizeof(note_buf) - 1);
         import_preview_lines_buf = currentSettings.import_preview_lines;
+        import_batch_size_buf = currentSettings.import_batch_size;
+        db_cache_size_kb_buf = currentSettings.db_cache_size_kb;
+        db_mmap_size_mb_buf = currentSettings.db_mmap_size_mb;
+        db_busy_timeout_ms_buf = currentSettings.db_busy_timeout_ms;
+        payment_snapshot_buf = currentSettings.payment_snapshot;
     }
 }
 
@@ -30,6 +41,11 @@ void SettingsView::SaveSettings() {
         currentSettings.period_end_date = end_date_buf;
         currentSettings.note = note_buf;
         currentSettings.import_preview_lines = import_preview_lines_buf;
+        currentSettings.import_batch_size = import_batch_size_buf;
+        currentSettings.db_cache_size_kb = db_cache_size_kb_buf;
+        currentSettings.db_mmap_size_mb = db_mmap_size_mb_buf;
+        currentSettings.db_busy_timeout_ms = db_busy_timeout_ms_buf;
+        currentSettings.payment_snapshot = payment_snapshot_buf;
         if (dbManager->updateSettings(currentSettings)) {
             std::cout << "DEBUG: Settings saved successfully." << std::endl;
         } else {
@@ -54,6 +70,31 @@ void SettingsView::Render() {
         ImGui::InputText("Дата окончания периода", end_date_buf, sizeof(end_date_buf));
         ImGui::InputTextMultiline("Примечание", note_buf, sizeof(note_buf));
         ImGui::InputInt("Строк предпросмотра", &import_preview_lines_buf);
+        if (ImGui::InputInt("Строк в транзакции импорта", &import_batch_size_buf)) {
+            if (import_batch_size_buf < 1) import_batch_size_buf = 1;
+        }
+
+        ImGui::Separator();
+        ImGui::Text("Параметры базы данных");
+        if (ImGui::InputInt("Кэш страниц, КиБ", &db_cache_size_kb_buf, 1024, 16384)) {
+            if (db_cache_size_kb_buf < 0) db_cache_size_kb_buf = 0;
+        }
+        if (ImGui::InputInt("Отображение в память, МиБ", &db_mmap_size_mb_buf, 16, 256)) {
+            if (db_mmap_size_mb_buf < 0) db_mmap_size_mb_buf = 0;
+        }
+        if (ImGui::InputInt("Ожидание блокировки, мс", &db_busy_timeout_ms_buf, 100, 1000)) {
+            if (db_busy_timeout_ms_buf < 0) db_busy_timeout_ms_buf = 0;
+        }
+        ImGui::Checkbox("Снимок платежей в памяти для итогов", &payment_snapshot_buf);
+
+        if (dbManager) {
+            ImGui::Text("Кэш SQL-запросов: попаданий %zu, промахов %zu",
+                        dbManager->getStatementCacheHits(),
+                        dbManager->getStatementCacheMisses());
+            ImGui::Text("Кэш SQL-запросов импорта: попаданий %zu, промахов %zu",
+                        dbManager->getWriterStatementCacheHits(),
+                        dbManager->getWriterStatementCacheMisses());
+        }
 
         if (ImGui::Button("Сохранить")) {
             SaveSettings();
@@ -24,4 +24,9 @@ private:
     char end_date_buf[12];   // YYYY-MM-DD
     char note_buf[512];
     int import_preview_lines_buf;
+    int import_batch_size_buf;
+    int db_cache_size_kb_buf;
+    int db_mmap_size_mb_buf;
+    int db_busy_timeout_ms_buf;
+    bool payment_snapshot_buf;
 };
@@ -0,0 +1,143 @@
+#include <memory>
+#include <string>
+#include <string_view>
+#include <vector>
+#include "BuiltinMatchers.h"
+#include "DatabaseManager.h"
+#include "RegexMatcher.h"
+#include "TestCheck.h"
+
+// Назначения платежей для сверки сканеров с регулярными выражениями:
+// все ключевые слова, их пересечения, номер без пробела перед датой,
+// лишние пробелы, запятые, годы из двух и четырёх цифр и неполные даты.
+static const char *const CORPUS[] = {
+    "",
+    "Оплата по контракту № 12/3 от 01.02.2020 за услуги",
+    "Оплата по контракту 12/3 от 01.02.2020",
+    "Оплата по контр № 77-А от 05.03.2022",
+    "Оплата по контр.№77-А от 05.03.2022",
+    "по контрактуN5 01.01.21",
+    "Контракт №4411 от 10.10.2020, акт 8 от 11.10.2020",
+    "Контракт 4411от10.10.2020",
+    "Контракт № 4411    от    10.10.2020",
+    "Контракт №,4411 от 10.10.2020",
+    "Контракт № от 10.10.2020",
+    "дог. № 15 от 12.12.19 сч-ф 16 от 13.12.19",
+    "дог.15/2019 13.12.2019",
+    "дог 15 от 13.12.2019",
+    "К-т 1201.02.2020",
+    "К-т № 1201.02.2020 счет на оплату 55 от 02.02.2020",
+    "К-т №01.02.2020",
+    "по К-т № 5 от 1.02.2020; К-т 6 от 01.02.2020",
+    "Оплата по сч. 123 от 01.02.2020",
+    "Оплата по сч.123 от 01.02.2020",
+    "Оплата по сч 123 от 01.02.2020",
+    "Оплата по сч-ф 123 от 01.02.2020",
+    "Оплата по счету 123 от 01.02.2020",
+    "счет на оплату № 7 от 03.04.2021",
+    "акт выполненных работ 9 от 03.04.2021",
+    "акт № 9 от 03.04.2021, сч. 10 от 04.04.2021",
+    "№ 9 от 03.04.2021",
+    "№9от03.04.2021",
+    "№ 9 от 03.04",
+    "№ 9 от 03.04.2",
+    "Контракт 1 от 01.01.2021\tакт 2\tот\t02.01.2021",
+    "Контракт 1 от\n01.01.2021",
+    "Оплата за январь; в т.ч. К226=100.00 К310=5.5",
+    "Оплата; в т.ч. К226=100,00 К310=.5 К34=1 К3450=2 К226=",
+    "К226 К310=1.0.0 K226=5 К22",
+    "ККК123=4",
+    "Налог, КБК 18210102010011000110, К211",
+};
+
+static bool SameMatch(bool found_a, const std::vector<std::string_view> &a,
+                      bool found_b, const std::vector<std::string_view> &b) {
+    if (found_a != found_b) {
+        return false;
+    }
+    if (!found_a) {
+        return true;
+    }
+    if (a.size() != b.size()) {
+        return false;
+    }
+    for (size_t i = 0; i < a.size(); ++i) {
+        // Сравниваются позиции, а не только текст групп
+        if (a[i].data() != b[i].data() || a[i].size() != b[i].size()) {
+            if (!a[i].empty() || !b[i].empty()) {
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+// Все совпадения подряд в каждой строке, как при разборе "; в т.ч."
+static void CheckScanner(const char *pattern) {
+    auto scanner = BuiltinMatchers::Find(pattern);
+    std::string error;
+    auto reference = RegexMatcher::CompileEngine(pattern, &error);
+    CHECK(scanner != nullptr);
+    CHECK_EQ(error, std::string());
+    if (!scanner || !reference) {
+        return;
+    }
+    CHECK_EQ(scanner->GroupCount(), reference->GroupCount());
+
+    std::vector<std::string_view> expected;
+    std::vector<std::string_view> actual;
+    for (const char *line : CORPUS) {
+        const std::string_view text = line;
+        size_t pos = 0;
+        while (pos <= text.size()) {
+            const bool found_expected = reference->Search(text, expected, pos);
+            const bool found_actual = scanner->Search(text, actual, pos);
+            if (!SameMatch(found_expected, expected, found_actual, actual)) {
+                ++TestCheck::failures;
+                std::cerr << "Scanner for '" << pattern << "' differs from "
+                          << reference->Backend() << " on '" << line
+                          << "' @" << pos << std::endl;
+                break;
+            }
+            if (!found_expected) {
+                break;
+            }
+            const size_t end =
+                expected[0].data() + expected[0].size() - text.data();
+            pos = expected[0].empty() ? end + 1 : end;
+        }
+    }
+}
+
+// Сканеры подменяют движок только при точном совпадении шаблона, поэтому
+// шаблоны новой базы должны совпадать с BuiltinMatchers
+static void TestDefaultPatterns() {
+    DatabaseManager db;
+    CHECK(db.open(":memory:"));
+    const std::string expected[] = {BuiltinMatchers::CONTRACT_PATTERN,
+                                    BuiltinMatchers::INVOICE_PATTERN,
+                                    BuiltinMatchers::KOSGU_PATTERN};
+    const std::vector<Regex> regexes = db.getRegexes();
+    CHECK_EQ(regexes.size(), static_cast<size_t>(3));
+    for (size_t i = 0; i < regexes.size() && i < 3; ++i) {
+        CHECK_EQ(regexes[i].pattern, expected[i]);
+        CHECK(RegexMatcher::Get(regexes[i].pattern)->Backend() ==
+              std::string("builtin"));
+    }
+}
+
+static void TestOtherPatterns() {
+    CHECK(BuiltinMatchers::Find("К(\\d{3})\\s") == nullptr);
+    auto matcher = RegexMatcher::Get("К(\\d{3})\\s");
+    CHECK(matcher != nullptr && matcher->Backend() != std::string("builtin"));
+}
+
+int main() {
+    CheckScanner(BuiltinMatchers::CONTRACT_PATTERN);
+    CheckScanner(BuiltinMatchers::INVOICE_PATTERN);
+    CheckScanner(BuiltinMatchers::KOSGU_PATTERN);
+    CheckScanner(BuiltinMatchers::KOSGU_DETAILS_PATTERN);
+    TestDefaultPatterns();
+    TestOtherPatterns();
+    return TestResult();
+}
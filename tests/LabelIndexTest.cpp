@@ -0,0 +1,117 @@
+#include <string>
+#include <vector>
+#include "LabelIndex.h"
+#include "TestCheck.h"
+#include "Utf8.h"
+
+static const std::vector<std::string> LABELS = {
+    "ООО Ромашка",
+    "ООО \"Ромашка-2\"",
+    "АО Василёк",
+    "ИП Ёлкин",
+    "ИП Елкин",
+    "225 Услуги связи",
+    "226 Прочие работы, услуги",
+    "310 Увеличение стоимости основных средств",
+    "Contract 4411",
+    "contract 4412",
+    "Café Müller",
+    "",
+    "а",
+    "ab",
+    "ООО Ромашка",
+};
+
+// Ожидаемый результат простым перебором: короткий запрос - начало подписи,
+// от трёх символов - любая её часть
+static std::vector<int> LinearFind(const std::string& query) {
+    const std::string folded_query = Utf8::FoldCase(query);
+    size_t points = 0;
+    for (unsigned char c : folded_query) {
+        points += (c & 0xC0) != 0x80;
+    }
+    std::vector<int> matches;
+    for (size_t i = 0; i < LABELS.size(); ++i) {
+        const std::string folded = Utf8::FoldCase(LABELS[i]);
+        const bool match =
+            points < 3
+                ? folded.compare(0, folded_query.size(), folded_query) == 0
+                : folded.find(folded_query) != std::string::npos;
+        if (match) {
+            matches.push_back(static_cast<int>(i));
+        }
+    }
+    return matches;
+}
+
+static std::vector<int> IndexFind(const LabelIndex& index,
+                                  const std::string& query) {
+    std::vector<int> matches;
+    index.Find(query, matches);
+    return matches;
+}
+
+static void CheckQuery(const LabelIndex& index, const std::string& query) {
+    const std::vector<int> expected = LinearFind(query);
+    const std::vector<int> actual = IndexFind(index, query);
+    if (actual != expected) {
+        ++TestCheck::failures;
+        std::cerr << "LabelIndex::Find(\"" << query << "\"): "
+                  << actual.size() << " matches, expected "
+                  << expected.size() << std::endl;
+    }
+}
+
+static void TestShortQueries(const LabelIndex& index) {
+    // Один-два символа: только начало подписи, без учёта регистра
+    CHECK_EQ(IndexFind(index, "о").size(), static_cast<size_t>(3));
+    CHECK(IndexFind(index, "ус").empty()); // "услуги" не в начале
+    CHECK(IndexFind(index, "ab") == std::vector<int>{13});
+    CHECK(IndexFind(index, "иП") == (std::vector<int>{3, 4}));
+    for (const char* query : {"О", "оо", "Ал", "а", "А", "и", "Ип", "2", "22",
+                              "c", "Co", "é", "Ca", "\"", "z"}) {
+        CheckQuery(index, query);
+    }
+}
+
+static void TestLongQueries(const LabelIndex& index) {
+    // От трёх символов: любая часть подписи
+    CHECK(IndexFind(index, "РОМАШКА") == (std::vector<int>{0, 1, 14}));
+    CHECK(IndexFind(index, "услуги") == (std::vector<int>{5, 6}));
+    CHECK(IndexFind(index, "Ёлк") == std::vector<int>{3});
+    CHECK(IndexFind(index, "елк") == std::vector<int>{4});
+    for (const char* query : {"ооо", "ООО \"", "ашка-", "441", "ACT 44",
+                              "café", "MÜLLER", "василёк", "василек", "ств",
+                              "средств ", "нет такой", "2 Ус"}) {
+        CheckQuery(index, query);
+    }
+}
+
+static void TestEmptyQueryAndRebuild() {
+    LabelIndex index;
+    std::vector<int> matches;
+    index.Find("", matches);
+    CHECK(matches.empty());
+
+    index.Build(LABELS);
+    const unsigned generation = index.Generation();
+    index.Find("", matches);
+    CHECK_EQ(matches.size(), LABELS.size());
+
+    index.Build({"Один", "Два"});
+    CHECK(index.Generation() != generation);
+    CHECK(IndexFind(index, "ромашка").empty());
+    CHECK(IndexFind(index, "дв") == std::vector<int>{1});
+    index.Clear();
+    CHECK_EQ(index.Size(), static_cast<size_t>(0));
+    CHECK(IndexFind(index, "один").empty());
+}
+
+int main() {
+    LabelIndex index;
+    index.Build(LABELS);
+    TestShortQueries(index);
+    TestLongQueries(index);
+    TestEmptyQueryAndRebuild();
+    return TestResult();
+}
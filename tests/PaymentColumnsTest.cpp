@@ -0,0 +1,121 @@
+#include <cstdint>
+#include <string>
+#include "PaymentColumns.h"
+#include "TestCheck.h"
+
+static void TestPackDate() {
+    CHECK_EQ(PaymentColumns::PackDate("2024-03-15"), 20240315);
+    CHECK_EQ(PaymentColumns::PackDate("1999-12-31"), 19991231);
+    CHECK_EQ(PaymentColumns::PackDate("0000-00-00"), 0);
+    // Даты в другом виде не разбираются
+    CHECK_EQ(PaymentColumns::PackDate(""), 0);
+    CHECK_EQ(PaymentColumns::PackDate("2024/03/15"), 0);
+    CHECK_EQ(PaymentColumns::PackDate("15.03.2024"), 0);
+    CHECK_EQ(PaymentColumns::PackDate("2024-3-15"), 0);
+    CHECK_EQ(PaymentColumns::PackDate("2024-03-15 10:00"), 0);
+    CHECK_EQ(PaymentColumns::PackDate("2024-0a-15"), 0);
+    CHECK_EQ(PaymentColumns::PackDate("-024-03-15"), 0);
+    // Упакованные даты сравниваются как числа
+    CHECK(PaymentColumns::PackDate("2023-12-31") <
+          PaymentColumns::PackDate("2024-01-01"));
+}
+
+static void TestToKopecks() {
+    CHECK_EQ(PaymentColumns::ToKopecks(0.0), int64_t{0});
+    CHECK_EQ(PaymentColumns::ToKopecks(1.0), int64_t{100});
+    // 0.1 + 0.2 = 0.30000000000000004
+    CHECK_EQ(PaymentColumns::ToKopecks(0.1 + 0.2), int64_t{30});
+    // 0.29 * 100 = 28.999999999999996, 1.15 * 100 = 114.99999999999999
+    CHECK_EQ(PaymentColumns::ToKopecks(0.29), int64_t{29});
+    CHECK_EQ(PaymentColumns::ToKopecks(1.15), int64_t{115});
+    CHECK_EQ(PaymentColumns::ToKopecks(-0.29), int64_t{-29});
+    CHECK_EQ(PaymentColumns::ToKopecks(-1.15), int64_t{-115});
+    CHECK_EQ(PaymentColumns::ToKopecks(12345678.91), int64_t{1234567891});
+    // Доли копейки округляются до ближайшей, половина - от нуля
+    CHECK_EQ(PaymentColumns::ToKopecks(0.004), int64_t{0});
+    CHECK_EQ(PaymentColumns::ToKopecks(0.006), int64_t{1});
+    CHECK_EQ(PaymentColumns::ToKopecks(0.125), int64_t{13});
+    CHECK_EQ(PaymentColumns::ToKopecks(-0.125), int64_t{-13});
+
+    // Любая сумма с двумя знаками после запятой переводится точно
+    int failed = 0;
+    for (int64_t kopecks = -100000; kopecks <= 100000; ++kopecks) {
+        failed += PaymentColumns::ToKopecks(kopecks / 100.0) != kopecks;
+    }
+    for (int64_t kopecks = 99999900000; kopecks <= 100000000000; ++kopecks) {
+        failed += PaymentColumns::ToKopecks(kopecks / 100.0) != kopecks;
+    }
+    CHECK_EQ(failed, 0);
+}
+
+static void TestSums() {
+    // Десять платежей по 0.1: в копейках сумма точная
+    PaymentColumns columns;
+    for (int i = 1; i <= 10; ++i) {
+        Payment payment;
+        payment.id = i;
+        payment.date = i <= 5 ? "2024-01-15" : "2024-02-15";
+        payment.amount = 0.1;
+        payment.counterparty_id = 7;
+        columns.PutPayment(payment);
+    }
+    CHECK_EQ(columns.SumPayments(7).kopecks, 100LL);
+    CHECK_EQ(columns.SumPayments(7).rows, 10LL);
+    CHECK_EQ(columns.SumPayments(7, 20240201, 20240229).kopecks, 50LL);
+    CHECK_EQ(columns.SumPayments(8).rows, 0LL);
+
+    columns.RemovePayment(3);
+    Payment changed;
+    changed.id = 10;
+    changed.date = "2024-02-15";
+    changed.amount = 1.15;
+    changed.counterparty_id = 7;
+    columns.PutPayment(changed);
+    CHECK_EQ(columns.SumPayments(7).kopecks, 80LL + 115LL);
+    CHECK_EQ(columns.SumPayments(7).rows, 9LL);
+}
+
+static void TestCounterpartyDetailSums() {
+    // Договоры 1 и 3 - контрагента 7, договор 2 - контрагента 8
+    PaymentColumns columns;
+    for (int id = 1; id <= 3; ++id) {
+        Contract contract;
+        contract.id = id;
+        contract.counterparty_id = id == 2 ? 8 : 7;
+        columns.PutContract(contract);
+    }
+    const int contract_of_detail[] = {1, 2, 3, -1, 1, 99};
+    for (int i = 0; i < 6; ++i) {
+        PaymentDetail detail{};
+        detail.id = i + 1;
+        detail.payment_id = i + 1;
+        detail.contract_id = contract_of_detail[i];
+        detail.amount = 10.0 * (i + 1);
+        columns.PutDetail(detail);
+    }
+    // Строки без договора и с неизвестным договором не считаются
+    CHECK_EQ(columns.SumCounterpartyDetails(7).kopecks, 9000LL);
+    CHECK_EQ(columns.SumCounterpartyDetails(7).rows, 3LL);
+    CHECK_EQ(columns.SumCounterpartyDetails(8).kopecks, 2000LL);
+    CHECK_EQ(columns.SumCounterpartyDetails(-1).rows, 0LL);
+
+    // Договор передан другому контрагенту, затем удалён
+    Contract moved;
+    moved.id = 3;
+    moved.counterparty_id = 8;
+    columns.PutContract(moved);
+    CHECK_EQ(columns.SumCounterpartyDetails(7).kopecks, 6000LL);
+    CHECK_EQ(columns.SumCounterpartyDetails(8).kopecks, 5000LL);
+    columns.RemoveContract(3);
+    CHECK_EQ(columns.SumCounterpartyDetails(8).kopecks, 2000LL);
+    columns.ClearContracts();
+    CHECK_EQ(columns.SumCounterpartyDetails(7).rows, 0LL);
+}
+
+int main() {
+    TestPackDate();
+    TestToKopecks();
+    TestSums();
+    TestCounterpartyDetailSums();
+    return TestResult();
+}
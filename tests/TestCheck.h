@@ -0,0 +1,40 @@
+#pragma once
+
+#include <iostream>
+
+// Проверки для модульных тестов без сторонних библиотек. Каждый тест -
+// отдельная программа: проваленная проверка печатается с местом в коде,
+// а TestResult() даёт ненулевой код возврата для CTest.
+namespace TestCheck {
+inline int failures = 0;
+}
+
+#define CHECK(condition)                                                     \
+    do {                                                                     \
+        if (!(condition)) {                                                  \
+            ++TestCheck::failures;                                           \
+            std::cerr << __FILE__ << ":" << __LINE__                         \
+                      << ": CHECK failed: " #condition << std::endl;         \
+        }                                                                    \
+    } while (0)
+
+#define CHECK_EQ(actual, expected)                                           \
+    do {                                                                     \
+        const auto &check_actual = (actual);                                 \
+        const auto &check_expected = (expected);                             \
+        if (!(check_actual == check_expected)) {                             \
+            ++TestCheck::failures;                                           \
+            std::cerr << __FILE__ << ":" << __LINE__                         \
+                      << ": CHECK_EQ failed: " #actual " == " #expected      \
+                      << "\n  actual:   " << check_actual                    \
+                      << "\n  expected: " << check_expected << std::endl;    \
+        }                                                                    \
+    } while (0)
+
+inline int TestResult() {
+    if (TestCheck::failures != 0) {
+        std::cerr << TestCheck::failures << " check(s) failed" << std::endl;
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,46 @@
+#include <string>
+#include "TestCheck.h"
+#include "Utf8.h"
+
+static void TestAscii() {
+    CHECK_EQ(Utf8::FoldCase("Hello, WORLD 123"), std::string("hello, world 123"));
+    CHECK_EQ(Utf8::FoldCase(""), std::string(""));
+}
+
+static void TestCyrillic() {
+    CHECK_EQ(Utf8::FoldCase("АБВГДЕЖЗИЙКЛМНОП"), std::string("абвгдежзийклмноп"));
+    CHECK_EQ(Utf8::FoldCase("РСТУФХЦЧШЩЪЫЬЭЮЯ"), std::string("рстуфхцчшщъыьэюя"));
+    CHECK_EQ(Utf8::FoldCase("Оплата по Договору № 5"), std::string("оплата по договору № 5"));
+    // Строчные остаются как есть
+    CHECK_EQ(Utf8::FoldCase("уже строчные"), std::string("уже строчные"));
+}
+
+static void TestYoAndU0400Block() {
+    CHECK_EQ(Utf8::FoldCase("ЁЖИК"), std::string("ёжик"));
+    CHECK_EQ(Utf8::FoldCase("Ё"), std::string("ё"));
+    // U+0400-U+040F: Ѐ Ђ Є Ї Ў Џ
+    CHECK_EQ(Utf8::FoldCase("ЀЂЄЇЎЏ"), std::string("ѐђєїўџ"));
+}
+
+static void TestLatin1() {
+    CHECK_EQ(Utf8::FoldCase("ÀÉÎÕÜÞ"), std::string("àéîõüþ"));
+    // Знак умножения - не буква
+    CHECK_EQ(Utf8::FoldCase("×"), std::string("×"));
+    // ß и ÿ не имеют пары в этом диапазоне
+    CHECK_EQ(Utf8::FoldCase("ßÿ"), std::string("ßÿ"));
+}
+
+static void TestInvalidSequences() {
+    // Обрезанная и некорректная последовательности копируются как есть
+    CHECK_EQ(Utf8::FoldCase("A\xD0"), std::string("a\xD0"));
+    CHECK_EQ(Utf8::FoldCase("\xFF\xFE"), std::string("\xFF\xFE"));
+}
+
+int main() {
+    TestAscii();
+    TestCyrillic();
+    TestYoAndU0400Block();
+    TestLatin1();
+    TestInvalidSequences();
+    return TestResult();
+}